@@ -0,0 +1,473 @@
+#include "chunk.hpp"
+#include "chunk_codec.hpp"
+#include "chunk_decorator.hpp"
+#include "chunk_mesher.hpp"
+#include "heightmap.hpp"
+#include "log/log.hpp"
+#include "settings.hpp"
+#include "simplex_noise.hpp"
+#include "time.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+// Measures the hot paths of the world on a fixed square of terrain around
+// the origin. The terrain comes from the default settings, the ini is not
+// read, so runs of different builds see the same blocks.
+
+namespace
+{
+// Chunks in every direction from the origin. Only the inner chunks have all
+// their neighbours and trees, these are measured.
+constexpr int terrain_radius = 5;
+
+constexpr int generation_repetitions = 5;
+constexpr int mesher_repetitions     = 20;
+constexpr int codec_repetitions      = 10;
+constexpr int noise_repetitions      = 20;
+constexpr int lookup_repetitions     = 10;
+
+// Terrain generation evaluates three octaves and the blue noise per column
+constexpr int noise_points_per_column = 4;
+
+double per_run(std::int64_t time, std::size_t runs)
+{
+  return static_cast<double>(time) / static_cast<double>(runs);
+}
+
+// Chunks of different sizes are compared per column of blocks
+double nanos_per_column(std::int64_t time, std::size_t chunk_runs)
+{
+  return 1000.0 * per_run(time, chunk_runs) / (Chunk::width() * Chunk::width());
+}
+
+// The square of chunks, generated and decorated like the streamer does
+class Terrain
+{
+public:
+  Terrain()
+  {
+    for (int x = -terrain_radius; x <= terrain_radius; ++x)
+    {
+      for (int z = -terrain_radius; z <= terrain_radius; ++z)
+      {
+        auto c = std::make_unique<Chunk>();
+        c->reset(glm::ivec3{x, 0, z});
+        c->generate(*heightmaps_.heightmap(glm::ivec2{x, z}));
+        chunks_.push_back(std::move(c));
+      }
+    }
+
+    const ChunkDecorator decorator;
+    for (const auto c : inner_chunks())
+    {
+      const auto position = c->position();
+      decorate(decorator.decorate(
+          position,
+          *heightmaps_.heightmap(glm::ivec2{position.x, position.z})));
+    }
+  }
+
+  // Null outside of the square
+  const Chunk *chunk(const glm::ivec3 &chunk_position) const
+  {
+    const auto i = index(chunk_position);
+    return i < 0 ? nullptr : chunks_[i].get();
+  }
+
+  std::vector<const Chunk *> inner_chunks() const
+  {
+    std::vector<const Chunk *> chunks;
+    for (const auto &c : chunks_)
+    {
+      const auto position = c->position();
+      if (std::abs(position.x) < terrain_radius &&
+          std::abs(position.z) < terrain_radius)
+      {
+        chunks.push_back(c.get());
+      }
+    }
+    return chunks;
+  }
+
+  // Air outside of the square
+  Block::Type block_type(const glm::ivec3 &world_position) const
+  {
+    const auto [chunk_position, block_position] =
+        world_position_to_chunk_position(world_position);
+    const auto c = chunk_position.y == 0 ? chunk(chunk_position) : nullptr;
+    return c == nullptr ? Block::Type::Air : c->block_type(block_position);
+  }
+
+  HeightmapCache &heightmaps()
+  {
+    return heightmaps_;
+  }
+
+  // In the order ChunkSnapshot expects them
+  std::array<const Chunk *, 4> neighbours(const Chunk &c) const
+  {
+    const auto position = c.position();
+    return {chunk(position + glm::ivec3{-1, 0, 0}),
+            chunk(position + glm::ivec3{1, 0, 0}),
+            chunk(position + glm::ivec3{0, 0, -1}),
+            chunk(position + glm::ivec3{0, 0, 1})};
+  }
+
+private:
+  HeightmapCache                      heightmaps_;
+  std::vector<std::unique_ptr<Chunk>> chunks_;
+
+  // -1 outside of the square
+  static int index(const glm::ivec3 &chunk_position)
+  {
+    if (std::abs(chunk_position.x) > terrain_radius ||
+        std::abs(chunk_position.z) > terrain_radius)
+    {
+      return -1;
+    }
+    constexpr auto side = 2 * terrain_radius + 1;
+    return (chunk_position.x + terrain_radius) * side + chunk_position.z +
+           terrain_radius;
+  }
+
+  void decorate(const std::vector<DecorationBlock> &blocks)
+  {
+    for (const auto &block : blocks)
+    {
+      const auto [chunk_position, block_position] =
+          world_position_to_chunk_position(block.position);
+      const auto i = index(chunk_position);
+      if (i < 0 || chunk_position.y != 0)
+      {
+        continue;
+      }
+      chunks_[i]->place_decoration_block(
+          block_position, block.type, block.is_replacing);
+    }
+  }
+};
+
+// Every simplex noise kernel the CPU supports, on points in the range the
+// terrain samples, including the blue noise at 50 times the block frequency
+void log_noise_benchmark()
+{
+  constexpr std::size_t point_count = 1 << 16;
+
+  std::mt19937                          rng(1);
+  std::uniform_real_distribution<float> position(-500000.0f, 500000.0f);
+  std::uniform_real_distribution<float> near_position(-100.0f, 100.0f);
+  std::vector<float>                    x(point_count);
+  std::vector<float>                    y(point_count);
+  for (std::size_t i = 0; i < point_count; ++i)
+  {
+    auto &distribution = i % 2 == 0 ? position : near_position;
+    x[i]               = distribution(rng);
+    y[i]               = distribution(rng);
+  }
+
+  // The glm kernel comes last, the others are compared to it
+  auto kernels = simplex_noise_kernels();
+  std::reverse(kernels.begin(), kernels.end());
+  std::vector<float> expected(point_count);
+  kernels.front().function(x.data(), y.data(), expected.data(), point_count);
+
+  std::vector<float> noise(point_count);
+  double             scalar_columns_per_second = 0.0;
+  for (const auto &kernel : kernels)
+  {
+    if (!kernel.is_supported)
+    {
+      continue;
+    }
+
+    const auto start = current_time_micros();
+    for (int i = 0; i < noise_repetitions; ++i)
+    {
+      kernel.function(x.data(), y.data(), noise.data(), point_count);
+    }
+    const auto time =
+        std::max<std::int64_t>(current_time_micros() - start, 1);
+
+    float error = 0.0f;
+    for (std::size_t i = 0; i < point_count; ++i)
+    {
+      error = std::max(error, std::abs(noise[i] - expected[i]));
+    }
+
+    const auto columns_per_second = 1e6 * point_count * noise_repetitions /
+                                    noise_points_per_column / time;
+    if (scalar_columns_per_second == 0.0)
+    {
+      scalar_columns_per_second = columns_per_second;
+    }
+    LOG_INFO() << "Simplex noise " << kernel.name << ": "
+               << columns_per_second / 1e6 << " M columns/s ("
+               << columns_per_second / scalar_columns_per_second
+               << "x scalar), difference to glm " << error;
+  }
+}
+
+// Heightmaps and terrain blocks, without the trees
+void log_generation_benchmark()
+{
+  constexpr int side        = 2 * terrain_radius + 1;
+  constexpr int chunk_count = side * side;
+
+  Chunk        c;
+  std::int64_t time = 0;
+  for (int i = 0; i < generation_repetitions; ++i)
+  {
+    // A new cache, so the heightmaps are computed again
+    HeightmapCache heightmaps;
+    const auto     start = current_time_micros();
+    for (int x = -terrain_radius; x <= terrain_radius; ++x)
+    {
+      for (int z = -terrain_radius; z <= terrain_radius; ++z)
+      {
+        c.reset(glm::ivec3{x, 0, z});
+        c.generate(*heightmaps.heightmap(glm::ivec2{x, z}));
+      }
+    }
+    time += current_time_micros() - start;
+  }
+
+  const auto runs = static_cast<std::size_t>(chunk_count) *
+                    generation_repetitions;
+  LOG_INFO() << "Generation: " << chunk_count << " chunks x "
+             << generation_repetitions << ", " << per_run(time, runs)
+             << " us/chunk, " << nanos_per_column(time, runs) << " ns/column";
+}
+
+void log_mesher_benchmark(const Terrain &terrain)
+{
+  const auto chunks = terrain.inner_chunks();
+
+  std::vector<ChunkSnapshot> snapshots;
+  snapshots.reserve(chunks.size());
+  std::int64_t snapshot_time = 0;
+  for (int i = 0; i < mesher_repetitions; ++i)
+  {
+    snapshots.clear();
+    const auto start = current_time_micros();
+    for (const auto c : chunks)
+    {
+      snapshots.emplace_back(*c, terrain.neighbours(*c));
+    }
+    snapshot_time += current_time_micros() - start;
+  }
+  const auto runs = chunks.size() * mesher_repetitions;
+  LOG_INFO() << "Snapshot: " << chunks.size() << " chunks x "
+             << mesher_repetitions << ", " << per_run(snapshot_time, runs)
+             << " us/chunk";
+
+  using GenerateQuads =
+      void (*)(const ChunkSnapshot &, std::vector<MeshQuad> &);
+  const std::array<std::pair<ChunkSettings::Mesher, GenerateQuads>, 3>
+      meshers{{
+          {ChunkSettings::Mesher::Naive, ChunkMesher::generate_naive_quads},
+          {ChunkSettings::Mesher::Greedy, ChunkMesher::generate_greedy_quads},
+          {ChunkSettings::Mesher::Binary, ChunkMesher::generate_binary_quads},
+      }};
+  const std::array<const char *, 3> names{"Naive", "Greedy", "Binary"};
+
+  for (std::size_t m = 0; m < meshers.size(); ++m)
+  {
+    const auto [mesher, generate_quads] = meshers[m];
+    if (mesher == ChunkSettings::Mesher::Binary && Chunk::width() > 62)
+    {
+      continue;
+    }
+
+    // Only the quads, the part the meshers differ in
+    std::vector<MeshQuad> quads;
+    std::int64_t          quads_time = 0;
+    for (int i = 0; i < mesher_repetitions; ++i)
+    {
+      for (const auto &snapshot : snapshots)
+      {
+        quads.clear();
+        const auto start = current_time_micros();
+        generate_quads(snapshot, quads);
+        quads_time += current_time_micros() - start;
+      }
+    }
+
+    // The whole mesh with its vertices, like the workers build it. The
+    // first pass grows the buffers, the later ones should not allocate.
+    ChunkSettings settings;
+    settings.mesher = mesher;
+    const ChunkMesher chunk_mesher{settings};
+    ChunkMeshData     mesh_data;
+    std::int64_t      mesh_time        = 0;
+    std::size_t       quad_count       = 0;
+    int               allocation_count = 0;
+    for (int i = 0; i < mesher_repetitions; ++i)
+    {
+      for (const auto &snapshot : snapshots)
+      {
+        const auto start = current_time_micros();
+        chunk_mesher.mesh(snapshot, mesh_data);
+        mesh_time += current_time_micros() - start;
+        quad_count += mesh_data.quad_count;
+        if (i > 0)
+        {
+          allocation_count += mesh_data.allocation_count;
+        }
+      }
+    }
+
+    LOG_INFO() << names[m] << " mesher: quads " << per_run(quads_time, runs)
+               << " us/chunk, mesh " << per_run(mesh_time, runs)
+               << " us/chunk (" << nanos_per_column(mesh_time, runs)
+               << " ns/column), " << quad_count / runs << " quads/chunk, "
+               << allocation_count << " buffer allocations after the first "
+               << "pass";
+  }
+}
+
+// Blocks and terrain heights at random positions in the inner chunks, the
+// lookups the player and the streamer do every frame
+void log_lookup_benchmark(Terrain &terrain)
+{
+  constexpr std::size_t lookup_count = 1 << 16;
+  constexpr int         min_block    = -(terrain_radius - 1) * Chunk::width();
+  constexpr int         max_block    = terrain_radius * Chunk::width() - 1;
+
+  std::mt19937                       rng(1);
+  std::uniform_int_distribution<int> horizontal(min_block, max_block);
+  std::uniform_int_distribution<int> vertical(0, Chunk::height() - 1);
+  std::vector<glm::ivec3>            positions(lookup_count);
+  for (auto &position : positions)
+  {
+    position = {horizontal(rng), vertical(rng), horizontal(rng)};
+  }
+
+  // The counts keep the lookups from being optimized away
+  std::size_t opaque_count = 0;
+  const auto  block_start = current_time_micros();
+  for (int i = 0; i < lookup_repetitions; ++i)
+  {
+    for (const auto &position : positions)
+    {
+      opaque_count += Block::is_opaque(terrain.block_type(position));
+    }
+  }
+  const auto block_time =
+      std::max<std::int64_t>(current_time_micros() - block_start, 1);
+
+  // The heightmaps of the terrain are cached, like around the player
+  auto        &heightmaps    = terrain.heightmaps();
+  std::int64_t height_sum    = 0;
+  const auto   surface_start = current_time_micros();
+  for (int i = 0; i < lookup_repetitions; ++i)
+  {
+    for (const auto &position : positions)
+    {
+      height_sum += heightmaps.surface_height(position.x, position.z);
+    }
+  }
+  const auto surface_time =
+      std::max<std::int64_t>(current_time_micros() - surface_start, 1);
+
+  const auto lookups = static_cast<double>(lookup_count) * lookup_repetitions;
+  LOG_INFO() << "Lookups: block " << lookups / block_time
+             << " M/s, surface height " << lookups / surface_time
+             << " M/s (" << opaque_count << " opaque, height sum " << height_sum
+             << ")";
+}
+
+// Compression ratio and throughput of the format chunks are saved in,
+// measured in uncompressed blocks
+void log_codec_benchmark(const Terrain &terrain)
+{
+  const auto chunks = terrain.inner_chunks();
+
+  std::vector<std::vector<std::uint8_t>> encoded(chunks.size());
+  const auto encode_start = current_time_micros();
+  for (int i = 0; i < codec_repetitions; ++i)
+  {
+    for (std::size_t c = 0; c < chunks.size(); ++c)
+    {
+      encoded[c] = encode_chunk_blocks(chunks[c]->blocks(), true);
+    }
+  }
+  const auto encode_time = current_time_micros() - encode_start;
+
+  std::size_t encoded_bytes = 0;
+  for (const auto &data : encoded)
+  {
+    encoded_bytes += data.size();
+  }
+
+  // Decodes into a chunk like loading does
+  ChunkBlockStorage blocks{Chunk::width(), Chunk::height()};
+  const auto        decode_start = current_time_micros();
+  for (int i = 0; i < codec_repetitions; ++i)
+  {
+    for (const auto &data : encoded)
+    {
+      blocks.clear();
+      decode_chunk_blocks(data,
+                          Chunk::width(),
+                          Chunk::height(),
+                          [&blocks](const BlockRun &run)
+                          {
+                            if (run.type == Block::Type::Air)
+                            {
+                              return;
+                            }
+                            for (int y = run.y; y < run.y + run.length; ++y)
+                            {
+                              blocks.set_type(run.x, y, run.z, run.type);
+                            }
+                          });
+      blocks.compact();
+    }
+  }
+  const auto decode_time = current_time_micros() - decode_start;
+
+  // One byte per block uncompressed, bytes per microsecond are MB/s
+  const auto raw_bytes = static_cast<double>(Chunk::width()) *
+                         Chunk::width() * Chunk::height() * chunks.size();
+  const auto processed = raw_bytes * codec_repetitions;
+  LOG_INFO() << "Chunk codec: " << chunks.size() << " chunks x "
+             << codec_repetitions << ", " << encoded_bytes / chunks.size()
+             << " bytes/chunk (" << raw_bytes / encoded_bytes
+             << ":1), encode "
+             << processed / std::max<std::int64_t>(encode_time, 1) / 1000.0
+             << " GB/s, decode "
+             << processed / std::max<std::int64_t>(decode_time, 1) / 1000.0
+             << " GB/s";
+}
+} // namespace
+
+int main()
+{
+#if defined(CHUNK_PALETTE_STORAGE)
+  const auto storage = "palette";
+#elif defined(CHUNK_MORTON_LAYOUT)
+  const auto storage = "Morton";
+#else
+  const auto storage = "column";
+#endif
+  LOG_INFO() << "Chunks of " << Chunk::width() << "x" << Chunk::height()
+             << " blocks, " << storage << " storage";
+
+  log_noise_benchmark();
+  log_generation_benchmark();
+
+  Terrain terrain;
+  log_lookup_benchmark(terrain);
+  log_mesher_benchmark(terrain);
+  log_codec_benchmark(terrain);
+
+  return EXIT_SUCCESS;
+}
@@ -1,9 +1,9 @@
 #version 460 core
 
-layout (location = 0) in vec3 in_position;
-layout (location = 1) in vec3 in_normal;
-layout (location = 2) in vec2 in_tex_coord;
-layout (location = 3) in int in_tex_index;
+// Packed chunk vertex, see ChunkVertex in chunk.hpp
+// x: 8 bits, y: 10 bits, z: 8 bits, face: 3 bits, lowered top: bit 31
+// u: 10 bits, v: 10 bits, texture layer: 12 bits
+layout (location = 0) in uvec2 in_vertex;
 
 out VS_OUT
 {
@@ -22,8 +22,26 @@ uniform vec4 clip_plane = vec4(0.0f, -1.0f, 0.0f, 5.0f);
 
 uniform mat4 model_matrix;
 
+// Indexed by the face id in the order of faces in chunk_mesher.cpp
+const vec3 face_normals[6] = vec3[6](
+  vec3(0.0, 0.0, 1.0),
+  vec3(0.0, 0.0, -1.0),
+  vec3(0.0, 1.0, 0.0),
+  vec3(0.0, -1.0, 0.0),
+  vec3(-1.0, 0.0, 0.0),
+  vec3(1.0, 0.0, 0.0)
+);
+
 void main()
 {
+  vec3 in_position = vec3(bitfieldExtract(in_vertex.x, 0, 8),
+                          bitfieldExtract(in_vertex.x, 8, 10),
+                          bitfieldExtract(in_vertex.x, 18, 8));
+  uint face = bitfieldExtract(in_vertex.x, 26, 3);
+  vec3 in_normal = face_normals[face];
+  vec2 in_tex_coord = vec2(bitfieldExtract(in_vertex.y, 0, 10),
+                           bitfieldExtract(in_vertex.y, 10, 10));
+  int in_tex_index = int(bitfieldExtract(in_vertex.y, 20, 12));
 
   vec4 position = vec4(in_position, 1.0);
   vec3 normal = in_normal;
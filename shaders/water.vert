@@ -1,9 +1,9 @@
 #version 460 core
 
-layout (location = 0) in vec3 in_position;
-layout (location = 1) in vec3 in_normal;
-layout (location = 2) in vec2 in_tex_coord;
-layout (location = 3) in int in_tex_index;
+// Packed chunk vertex, see ChunkVertex in chunk.hpp
+// x: 8 bits, y: 10 bits, z: 8 bits, face: 3 bits, lowered top: bit 31
+// u: 10 bits, v: 10 bits, texture layer: 12 bits
+layout (location = 0) in uvec2 in_vertex;
 
 out VS_OUT
 {
@@ -21,10 +21,32 @@ uniform float fog_end = 400.0;
 
 uniform mat4 model_matrix;
 
+// Indexed by the face id in the order of faces in chunk_mesher.cpp
+const vec3 face_normals[6] = vec3[6](
+  vec3(0.0, 0.0, 1.0),
+  vec3(0.0, 0.0, -1.0),
+  vec3(0.0, 1.0, 0.0),
+  vec3(0.0, -1.0, 0.0),
+  vec3(-1.0, 0.0, 0.0),
+  vec3(1.0, 0.0, 0.0)
+);
+
 const float tiling = 0.1f;
+// Height of the water surface within its block
+const float water_block_height = 0.9f;
 
 void main()
 {
+  vec3 in_position = vec3(bitfieldExtract(in_vertex.x, 0, 8),
+                          bitfieldExtract(in_vertex.x, 8, 10),
+                          bitfieldExtract(in_vertex.x, 18, 8));
+  uint face = bitfieldExtract(in_vertex.x, 26, 3);
+  vec3 in_normal = face_normals[face];
+  vec2 in_tex_coord = vec2(bitfieldExtract(in_vertex.y, 0, 10),
+                           bitfieldExtract(in_vertex.y, 10, 10));
+  // The top of water sits a bit lower than a full block
+  in_position.y -= float(in_vertex.x >> 31) * (1.0 - water_block_height);
+
   vec4 position = vec4(in_position, 1.0);
   vec3 normal = in_normal;
 
@@ -1,4 +1,5 @@
 #include "application.hpp"
+#include "chunk.hpp"
 #include "event.hpp"
 #include "gl/gl_shader.hpp"
 #include "log/log.hpp"
@@ -7,15 +8,22 @@
 
 #include <GL/gl.h>
 #include <cstdlib>
+#include <filesystem>
 #include <iostream>
 #include <memory>
 #include <stdexcept>
+#include <system_error>
+#include <utility>
 
 namespace
 {
 constexpr auto opengl_version_major = 4;
 constexpr auto opengl_version_minor = 6;
 
+constexpr auto config_path = "data/voxelworld.ini";
+// Milliseconds between looking at the modification time of the config file
+constexpr std::int64_t config_check_interval = 1000;
+
 void glfw_error_callback(int error_code, const char *description)
 {
   LOG_ERROR() << "GLFW Error code: " << error_code
@@ -231,11 +239,29 @@ int Application::run()
   return EXIT_SUCCESS;
 }
 
-Config Application::config() const { return config_; }
+const Config &Application::config() const { return config_; }
+
+std::shared_ptr<const Settings> Application::settings() const
+{
+  return settings_;
+}
 
 void Application::init()
 {
-  config_.load_config("data/voxelworld.ini");
+  const auto start_time = current_time_micros();
+
+  config_.load_config(config_path);
+  settings_ = std::make_shared<const Settings>(Settings::from_config(config_));
+  const auto settings_time = current_time_micros() - start_time;
+
+  is_config_watched_ =
+      config_.config_value_bool("General", "watch_config", false);
+  if (is_config_watched_)
+  {
+    std::error_code status;
+    config_write_time_ = std::filesystem::last_write_time(config_path, status);
+    config_check_time_ = current_time_millis();
+  }
 
   // Load debug level
   const auto debug_level_str =
@@ -261,6 +287,17 @@ void Application::init()
     LOG_WARN() << "Unknown debug level: " << debug_level_str;
   }
 
+  // The chunk size is fixed at build time
+  if (config_.config_value_int("Chunk", "width", Chunk::width()) !=
+          Chunk::width() ||
+      config_.config_value_int("Chunk", "height", Chunk::height()) !=
+          Chunk::height())
+  {
+    LOG_WARN() << "Ignoring [Chunk] width and height, this build uses "
+               << Chunk::width() << "x" << Chunk::height()
+               << " chunks. Set CHUNK_WIDTH and CHUNK_HEIGHT in CMake.";
+  }
+
   if (!glfwInit())
   {
     throw std::runtime_error("Can not init GLFW");
@@ -393,15 +430,53 @@ void Application::init()
 
   // Create player
   player_ = std::make_unique<Player>();
+  player_->spawn(*world_);
 
-  // Load sky color
-  const auto sky_color_r =
-      config_.config_value_float("World", "sky_color_r", 0.0f);
-  const auto sky_color_g =
-      config_.config_value_float("World", "sky_color_g", 0.0f);
-  const auto sky_color_b =
-      config_.config_value_float("World", "sky_color_b", 0.0f);
-  sky_color_ = glm::vec3{sky_color_r, sky_color_g, sky_color_b};
+  sky_color_ = settings_->world.sky_color;
+
+  LOG_INFO() << "Started in " << (current_time_micros() - start_time) / 1000.0f
+             << " ms, reading the settings took " << settings_time << " us";
+}
+
+void Application::reload_config_if_changed()
+{
+  if (!is_config_watched_ ||
+      current_time_millis() - config_check_time_ < config_check_interval)
+  {
+    return;
+  }
+  config_check_time_ = current_time_millis();
+
+  // The file may be in the middle of being replaced
+  std::error_code status;
+  const auto      write_time =
+      std::filesystem::last_write_time(config_path, status);
+  if (status || write_time == config_write_time_)
+  {
+    return;
+  }
+  config_write_time_ = write_time;
+
+  Config config;
+  try
+  {
+    config.load_config(config_path);
+  }
+  catch (const std::runtime_error &error)
+  {
+    LOG_WARN() << "Keeping the old settings: " << error.what();
+    return;
+  }
+
+  auto old_settings = settings_;
+  config_           = std::move(config);
+  settings_         = std::make_shared<const Settings>(
+      Settings::from_config(config_));
+  sky_color_        = settings_->world.sky_color;
+  LOG_INFO() << "Reloaded " << config_path;
+
+  event_manager_.publish(
+      std::make_shared<SettingsChangedEvent>(old_settings, settings_));
 }
 
 void Application::main_loop()
@@ -416,6 +491,8 @@ void Application::main_loop()
 
     glfwPollEvents();
 
+    reload_config_if_changed();
+
     // Dispatch events
     event_manager_.dispatch();
 
@@ -427,7 +504,8 @@ void Application::main_loop()
       break;
     }
 
-    world_->set_player_position(player_->position());
+    world_->set_player_position(player_->position(),
+                                player_->camera().front());
 
     const auto projection_matrix =
         glm::perspective(glm::radians(player_->zoom()),
@@ -12,8 +12,11 @@
 #include "gl/gl_shader.hpp"
 #include "gui.hpp"
 #include "player.hpp"
+#include "settings.hpp"
 #include "world.hpp"
 
+#include <cstdint>
+#include <filesystem>
 #include <memory>
 
 class WindowResizeEvent : public Event
@@ -38,7 +41,12 @@ public:
 
   int run();
 
-  Config config() const;
+  // Values that are only read once at startup
+  const Config &config() const;
+
+  // Parsed values of the config, replaced when the file is reloaded. Holding
+  // on to the pointer keeps the snapshot alive.
+  std::shared_ptr<const Settings> settings() const;
 
   void on_window_framebuffer_size_callback(GLFWwindow *window,
                                            int         width,
@@ -84,7 +92,14 @@ private:
 
   float delta_time_{0.0f};
 
-  Config config_;
+  Config                          config_;
+  std::shared_ptr<const Settings> settings_{std::make_shared<Settings>()};
+
+  // The config file is reloaded when it changes if [General] watch_config
+  // is set
+  bool                            is_config_watched_ = false;
+  std::filesystem::file_time_type config_write_time_{};
+  std::int64_t                    config_check_time_ = 0;
 
   EventManager event_manager_;
 
@@ -105,4 +120,8 @@ private:
 
   void init();
   void main_loop();
+
+  // Loads the config file again if it was written since the last check and
+  // publishes a SettingsChangedEvent
+  void reload_config_if_changed();
 };
@@ -1,14 +1,18 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
 
+struct BlockProperties;
+
 class Block
 {
 public:
   static constexpr int width  = 1;
   static constexpr int height = 1;
 
-  enum class Type
+  // Air must stay last, stored chunks are checked against it
+  enum class Type : std::uint8_t
   {
     Grass,
     Dirt,
@@ -17,6 +21,7 @@ public:
     OakLeaves,
     Air,
   };
+  static constexpr int type_count = static_cast<int>(Type::Air) + 1;
 
   enum class Side
   {
@@ -28,9 +33,99 @@ public:
     Back,
   };
 
+  // Opaque blocks hide every face next to them, the others only the faces
+  // of blocks of the same class, like water next to water
+  enum class Transparency : std::uint8_t
+  {
+    Opaque,
+    Liquid,
+    Invisible,
+  };
+  static constexpr int transparency_count =
+      static_cast<int>(Transparency::Invisible) + 1;
+
+  // Mesh the faces of a block are drawn with
+  enum class MeshLayer : std::uint8_t
+  {
+    None,
+    Opaque,
+    Water,
+  };
+
+  [[nodiscard]] static constexpr const BlockProperties &
+  properties(Type type);
+
+  // Layer of the block texture array, see World::init()
+  [[nodiscard]] static constexpr int texture_layer(Type type, Side side);
+
+  [[nodiscard]] static constexpr bool is_opaque(Type type);
+
+  // Whether a block next to a face of the other block hides that face
+  [[nodiscard]] static constexpr bool is_face_hidden(Type type,
+                                                     Type neighbour_type);
+
   void               set_type(Type type);
   [[nodiscard]] Type type() const;
 
 private:
   Type type_ = Type::Air;
 };
+
+struct BlockProperties
+{
+  // Indexed by Block::Side
+  std::array<std::uint16_t, 6> texture_layers;
+  Block::Transparency          transparency;
+  Block::MeshLayer             mesh_layer;
+};
+
+// Indexed by Block::Type. New block types only need an entry here.
+inline constexpr std::array<BlockProperties, Block::type_count>
+    block_properties{{
+        // Grass: top, bottom and sides differ
+        {{0, 2, 1, 1, 1, 1},
+         Block::Transparency::Opaque,
+         Block::MeshLayer::Opaque},
+        // Dirt
+        {{2, 2, 2, 2, 2, 2},
+         Block::Transparency::Opaque,
+         Block::MeshLayer::Opaque},
+        // Water
+        {{3, 3, 3, 3, 3, 3},
+         Block::Transparency::Liquid,
+         Block::MeshLayer::Water},
+        // Oak: rings on top and bottom, bark on the sides
+        {{5, 5, 4, 4, 4, 4},
+         Block::Transparency::Opaque,
+         Block::MeshLayer::Opaque},
+        // OakLeaves
+        {{6, 6, 6, 6, 6, 6},
+         Block::Transparency::Opaque,
+         Block::MeshLayer::Opaque},
+        // Air
+        {{0, 0, 0, 0, 0, 0},
+         Block::Transparency::Invisible,
+         Block::MeshLayer::None},
+    }};
+
+constexpr const BlockProperties &Block::properties(Type type)
+{
+  return block_properties[static_cast<int>(type)];
+}
+
+constexpr int Block::texture_layer(Type type, Side side)
+{
+  return properties(type).texture_layers[static_cast<int>(side)];
+}
+
+constexpr bool Block::is_opaque(Type type)
+{
+  return properties(type).transparency == Transparency::Opaque;
+}
+
+constexpr bool Block::is_face_hidden(Type type, Type neighbour_type)
+{
+  const auto transparency = properties(neighbour_type).transparency;
+  return transparency == Transparency::Opaque ||
+         transparency == properties(type).transparency;
+}
@@ -0,0 +1,118 @@
+#include "block_storage.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+#ifdef CHUNK_MORTON_LAYOUT
+int bit_count(int value)
+{
+  int bits = 0;
+  while ((1 << bits) < value)
+  {
+    ++bits;
+  }
+  return bits;
+}
+
+bool is_power_of_two(int value) { return value > 0 && !(value & (value - 1)); }
+#endif
+} // namespace
+
+BlockStorage::BlockStorage(int width, int height)
+    : width_{width},
+      height_{height}
+{
+#ifdef CHUNK_MORTON_LAYOUT
+  if (!is_power_of_two(width_) || !is_power_of_two(height_))
+  {
+    throw std::runtime_error("Morton chunk layout needs power of two chunk "
+                             "dimensions, got " +
+                             std::to_string(width_) + "x" +
+                             std::to_string(height_));
+  }
+  morton_tables_ = &morton_tables(width_, height_);
+#endif
+
+  blocks_.resize(size());
+}
+
+int BlockStorage::width() const { return width_; }
+
+int BlockStorage::height() const { return height_; }
+
+std::size_t BlockStorage::size() const
+{
+  return static_cast<std::size_t>(width_) * width_ * height_;
+}
+
+void BlockStorage::clear() { blocks_.assign(size(), Block{}); }
+
+void BlockStorage::release() { decltype(blocks_){}.swap(blocks_); }
+
+void BlockStorage::compact() {}
+
+std::size_t BlockStorage::memory_usage() const
+{
+  return sizeof(*this) + blocks_.capacity() * sizeof(Block);
+}
+
+#ifdef CHUNK_MORTON_LAYOUT
+const BlockStorage::MortonTables &BlockStorage::morton_tables(int width,
+                                                              int height)
+{
+  // All chunks share the same dimensions, so the tables are built once
+  static const auto tables = [width, height]()
+  {
+    MortonTables result{};
+    result.width  = width;
+    result.height = height;
+    result.x.resize(width);
+    result.y.resize(height);
+    result.z.resize(width);
+
+    const auto width_bits  = bit_count(width);
+    const auto height_bits = bit_count(height);
+
+    // Interleave one bit of every axis that still has bits left. Chunks are
+    // higher than wide, so the upper bits of y end up at the top of the index
+    // and the index stays dense.
+    int        out_bit       = 0;
+    const auto interleave_bit =
+        [&out_bit](std::vector<std::uint32_t> &table, int bit)
+    {
+      for (std::size_t i = 0; i < table.size(); ++i)
+      {
+        if ((i >> bit) & 1)
+        {
+          table[i] |= std::uint32_t{1} << out_bit;
+        }
+      }
+      ++out_bit;
+    };
+
+    for (int bit = 0; bit < std::max(width_bits, height_bits); ++bit)
+    {
+      if (bit < width_bits)
+      {
+        interleave_bit(result.x, bit);
+      }
+      if (bit < height_bits)
+      {
+        interleave_bit(result.y, bit);
+      }
+      if (bit < width_bits)
+      {
+        interleave_bit(result.z, bit);
+      }
+    }
+
+    return result;
+  }();
+
+  assert(tables.width == width && tables.height == height);
+  return tables;
+}
+#endif
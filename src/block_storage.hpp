@@ -0,0 +1,91 @@
+#pragma once
+
+#include "aligned_allocator.hpp"
+#include "block.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Contiguous, cache line aligned storage for the blocks of one chunk.
+//
+// The memory layout is chosen at compile time. By default the blocks of a
+// column are stored next to each other (y is the fastest changing index),
+// which matches the column by column access of generation and meshing. With
+// CHUNK_MORTON_LAYOUT defined the bits of x, y and z are interleaved (Z-order
+// curve), which keeps blocks that are close in all three axes close in memory.
+class BlockStorage
+{
+public:
+  static constexpr std::size_t cache_line_size = 64;
+
+  BlockStorage(int width, int height);
+
+  [[nodiscard]] int         width() const;
+  [[nodiscard]] int         height() const;
+  [[nodiscard]] std::size_t size() const;
+
+  [[nodiscard]] Block::Type type(int x, int y, int z) const;
+  void                      set_type(int x, int y, int z, Block::Type type);
+
+  // Sets every block to air, keeping the memory. Allocates it again after
+  // release().
+  void clear();
+
+  // Frees the memory of the blocks, only clear() may be called afterwards
+  void release();
+
+  // Nothing to compact in a flat array, only here to match
+  // PaletteBlockStorage
+  void compact();
+
+  [[nodiscard]] std::size_t memory_usage() const;
+
+private:
+#ifdef CHUNK_MORTON_LAYOUT
+  struct MortonTables
+  {
+    int width{};
+    int height{};
+
+    std::vector<std::uint32_t> x;
+    std::vector<std::uint32_t> y;
+    std::vector<std::uint32_t> z;
+  };
+
+  static const MortonTables &morton_tables(int width, int height);
+
+  const MortonTables *morton_tables_{};
+#endif
+
+  int width_{};
+  int height_{};
+
+  std::vector<Block, AlignedAllocator<Block, cache_line_size>> blocks_;
+
+  [[nodiscard]] std::size_t index(int x, int y, int z) const;
+};
+
+inline std::size_t BlockStorage::index(int x, int y, int z) const
+{
+  assert(0 <= x && x < width_);
+  assert(0 <= y && y < height_);
+  assert(0 <= z && z < width_);
+
+#ifdef CHUNK_MORTON_LAYOUT
+  return morton_tables_->x[x] | morton_tables_->y[y] | morton_tables_->z[z];
+#else
+  return (static_cast<std::size_t>(x) * width_ + z) * height_ + y;
+#endif
+}
+
+inline Block::Type BlockStorage::type(int x, int y, int z) const
+{
+  return blocks_[index(x, y, z)].type();
+}
+
+inline void BlockStorage::set_type(int x, int y, int z, Block::Type type)
+{
+  blocks_[index(x, y, z)].set_type(type);
+}
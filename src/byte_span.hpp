@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Bytes owned by someone else, like std::span in C++20
+struct ByteSpan
+{
+  const std::uint8_t *data = nullptr;
+  std::size_t         size = 0;
+
+  ByteSpan() = default;
+  ByteSpan(const std::uint8_t *data, std::size_t size) : data{data}, size{size}
+  {
+  }
+  // Implicit, so vectors can be passed where a span is expected
+  ByteSpan(const std::vector<std::uint8_t> &bytes)
+      : data{bytes.data()},
+        size{bytes.size()}
+  {
+  }
+
+  [[nodiscard]] bool empty() const { return size == 0; }
+};
@@ -1,672 +1,284 @@
 #include "chunk.hpp"
-#include "application.hpp"
 #include "block.hpp"
+#include "chunk_codec.hpp"
+#include "chunk_mesher.hpp"
 #include "gl/gl_index_buffer.hpp"
 #include "gl/gl_vertex_buffer.hpp"
-#include "glm/gtc/noise.hpp"
+#include "heightmap.hpp"
 #include "math.hpp"
 #include "texture_atlas.hpp"
 #include "world.hpp"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cstdint>
+#include <functional>
 #include <limits>
 #include <memory>
-#include <random>
-
-int Chunk::width()
-{
-  static const auto w =
-      Application::instance()->config().config_value_int("Chunk", "width", 16);
-  return w;
-}
-
-int Chunk::height()
-{
-  static const auto h =
-      Application::instance()->config().config_value_int("Chunk",
-                                                         "height",
-                                                         256);
-  return h;
-}
-
-Chunk::Chunk()
-{
-  auto       app    = Application::instance();
-  const auto config = app->config();
-
-  c1_           = config.config_value_float("Chunk", "c1", 1.0f);
-  c2_           = config.config_value_float("Chunk", "c2", 0.7f);
-  c3_           = config.config_value_float("Chunk", "c3", 0.008f);
-  div_          = config.config_value_float("Chunk", "div", 1.0f);
-  frequency1_   = config.config_value_float("Chunk", "frequency1", 0.0003f);
-  frequency2_   = config.config_value_float("Chunk", "frequency2", 0.008f);
-  frequency3_   = config.config_value_float("Chunk", "frequency3", 0.1f);
-  e_            = config.config_value_float("Chunk", "e", 11.3);
-  fudge_factor_ = config.config_value_float("Chunk", "fudge_factor", 1.1);
-  water_level_ =
-      config.config_value_float("Chunk", "water_level", water_level_);
-  terraces_          = config.config_value_float("Chunk", "terraces", 180.0);
-  tree_density_      = config.config_value_int("Chunk", "tree_density", 6);
-  min_tree_height_   = config.config_value_int("Chunk", "min_tree_height", 5);
-  max_tree_height_   = config.config_value_int("Chunk", "max_tree_height", 11);
-  min_leaves_radius_ = config.config_value_int("Chunk", "min_leaves_radius", 3);
-  max_leaves_radius_ = config.config_value_int("Chunk", "max_leaves_radius", 5);
-  leave_density_     = config.config_value_int("Chunk", "leaves_density", 2);
-
-  blocks_.resize(width());
-  for (std::size_t x = 0; x < blocks_.size(); ++x)
-  {
-    blocks_[x].resize(width());
-    for (std::size_t z = 0; z < blocks_[x].size(); ++z)
-    {
-      blocks_[x][z].resize(height());
-    }
-  }
+
+namespace
+{
+// Revisions are unique across all chunks, so a mesh is never mistaken for
+// the mesh of a chunk that was unloaded and loaded again. Only used on the
+// main thread.
+unsigned next_revision()
+{
+  static unsigned revision = 0;
+  return ++revision;
+}
+} // namespace
+
+Chunk::Chunk() : blocks_{width(), height()}
+{
+  sections_.resize(section_count());
+}
+
+void Chunk::reset(const glm::ivec3 &position)
+{
+  assert(!is_generating_);
+
+  blocks_.clear();
+  std::fill(sections_.begin(), sections_.end(), Section{});
+  compressed_blocks_.clear();
+
+  position_          = position;
+  is_assigned_       = true;
+  is_generated_      = false;
+  is_decorating_     = false;
+  is_decorated_      = false;
+  is_modified_       = false;
+  is_compressed_     = false;
+  is_mesh_requested_ = false;
+  is_mesh_generated_ = false;
+  face_count_        = 0;
+  quad_count_        = 0;
+
+  // Meshes of the previous chunk that are still in flight are dropped
+  mesh_revision_ = next_revision();
 }
 
-[[nodiscard]] bool Chunk::is_generated() const { return is_generated_; }
+[[nodiscard]] bool Chunk::is_assigned() const { return is_assigned_; }
 
-void Chunk::generate(const glm::vec3 &position, const World & /*world*/)
+[[nodiscard]] bool Chunk::is_generated() const
+{
+  // is_generated_ is written by the worker, so only look at it once the
+  // worker is done
+  return !is_generating_ && is_generated_;
+}
+
+[[nodiscard]] bool Chunk::is_generating() const { return is_generating_; }
+
+void Chunk::set_generating(bool value) { is_generating_ = value; }
+
+void Chunk::generate([[maybe_unused]] const glm::vec3 &position,
+                     const World                      &world)
 {
   if (is_generated_)
   {
     return;
   }
 
-  position_ = glm::ivec3(static_cast<int>(position.x),
-                         static_cast<int>(position.y),
-                         static_cast<int>(position.z));
+  // The position was set by reset(), the world looks it up while workers
+  // generate
+  assert(is_assigned_ && position_ == glm::ivec3(static_cast<int>(position.x),
+                                                 static_cast<int>(position.y),
+                                                 static_cast<int>(position.z)));
 
-  // Generate blue noise
-  std::vector<std::vector<float>> blue_noise;
-  blue_noise.resize(blocks_.size());
-  for (std::size_t x = 0; x < blocks_.size(); ++x)
-  {
-    blue_noise[x].resize(blocks_[x].size());
-    for (std::size_t z = 0; z < blocks_.size(); ++z)
-    {
-      const auto world_position =
-          block_position_to_world_position(glm::ivec3{x, 0, z});
-
-      auto position_x = world_position.x + 0.5f;
-      auto position_z = world_position.z + 0.5f;
+  generate(*world.heightmap(glm::ivec2{position_.x, position_.z}));
+}
 
-      blue_noise[x][z] =
-          glm::simplex(glm::vec2{50.0f * position_x, 50.0f * position_z});
-    }
+void Chunk::generate(const ChunkHeightmap &heightmap)
+{
+  if (is_generated_)
+  {
+    return;
   }
+  assert(is_assigned_);
 
-  for (std::size_t x = 0; x < blocks_.size(); ++x)
+  const auto water_level = heightmap.water_level;
+  for (int x = 0; x < width(); ++x)
   {
-    for (std::size_t z = 0; z < blocks_[x].size(); ++z)
+    for (int z = 0; z < width(); ++z)
     {
-      const auto world_position =
-          block_position_to_world_position(glm::ivec3{x, 0, z});
-
-      auto position_x = world_position.x + 0.5f;
-      auto position_z = world_position.z + 0.5f;
-
-      // Calculate if a tree needs to be placed
-      double max = 0;
-      // there are more efficient algorithms than this
-      for (int yn = x - tree_density_;
-           yn <= static_cast<int>(x) + tree_density_;
-           yn++)
-      {
-        for (int xn = z - tree_density_;
-             xn <= static_cast<int>(z) + tree_density_;
-             xn++)
-        {
-          if (0 <= yn && yn < width() && 0 <= xn && xn < width())
-          {
-            const auto e = blue_noise[yn][xn];
-            if (e > max)
-            {
-              max = e;
-            }
-          }
-        }
-      }
-      bool place_tree = false;
-      if (blue_noise[x][z] == max)
+      const auto height = heightmap.height(x, z);
+      for (int y = 0; y <= height || y <= water_level; ++y)
       {
-        place_tree = true;
-      }
-
-      const auto noise =
-          c1_ * glm::simplex(glm::vec2{position_x * frequency1_ - 1.3f,
-                                       position_z * frequency1_}) +
-          c2_ * glm::simplex(glm::vec2{position_x * frequency2_ + 1.1f,
-                                       position_z * frequency2_ + 2.0f}) +
-          c3_ * glm::simplex(glm::vec2{position_x * frequency3_ + 5.3f,
-                                       position_z * frequency3_ + 0.2f});
-
-      auto normalized_noise =
-          (noise + c1_ + c2_ + c3_) / (((2.0f * (c1_ + c2_ + c3_))) * div_);
-
-      normalized_noise = glm::pow(normalized_noise * fudge_factor_, e_);
-      normalized_noise = glm::round(normalized_noise * terraces_) / terraces_;
-
-      auto height = static_cast<int>(normalized_noise * Chunk::height());
-      std::mt19937                       rng(94);
-      std::uniform_int_distribution<int> tree_height_gen(min_tree_height_,
-                                                         max_tree_height_);
-      std::uniform_int_distribution<int> leave_radius_gen(min_leaves_radius_,
-                                                          max_leaves_radius_);
-      std::uniform_int_distribution<int> leave_density_gen(0, leave_density_);
-
-      for (int y = 0; y <= height || y <= water_level_; ++y)
-      {
-        assert(0 <= y && y < static_cast<int>(blocks_[x][z].size()));
-        auto &block = blocks_[x][z][y];
+        assert(0 <= y && y < Chunk::height());
         if (y == height)
         {
-          if (y < water_level_)
+          if (heightmap.biome(x, z) == Biome::Lake)
           {
-            block.set_type(Block::Type::Dirt);
+            set_block_type(x, y, z, Block::Type::Dirt);
           }
           else
           {
-            block.set_type(Block::Type::Grass);
-
-            // Check if we need to place a tree
-            if (place_tree)
-            {
-              // Place tree
-              const auto tree_height = tree_height_gen(rng);
-              for (int i = y + 1; i < static_cast<int>(y) + tree_height &&
-                                  i < static_cast<int>(blocks_[x][z].size());
-                   ++i)
-              {
-                blocks_[x][z][i].set_type(Block::Type::Oak);
-              }
-
-              // Place leaves
-              const auto leave_radius = leave_radius_gen(rng);
-              for (int leave_x = -leave_radius; leave_x < leave_radius + 1;
-                   ++leave_x)
-              {
-                for (int leave_z = -leave_radius; leave_z < leave_radius + 1;
-                     ++leave_z)
-                {
-                  for (int leave_y = -leave_radius; leave_y < leave_radius + 1;
-                       ++leave_y)
-                  {
-                    const int real_leave_x{static_cast<int>(x + leave_x)};
-                    const int real_leave_y{tree_height + y + leave_y};
-                    const int real_leave_z{static_cast<int>(z + leave_z)};
-
-                    if (real_leave_x < 0 || real_leave_x >= Chunk::width() ||
-                        real_leave_z < 0 || real_leave_z >= Chunk::width() ||
-                        real_leave_y < 0 || real_leave_y >= Chunk::height())
-                    {
-                      continue;
-                    }
-                    if (leave_density_gen(rng) != leave_density_)
-                    {
-                      continue;
-                    }
-                    if (blocks_[real_leave_x][real_leave_z][real_leave_y]
-                            .type() == Block::Type::Air)
-                    {
-                      blocks_[real_leave_x][real_leave_z][real_leave_y]
-                          .set_type(Block::Type::OakLeaves);
-                    }
-                  }
-                }
-              }
-            }
+            set_block_type(x, y, z, Block::Type::Grass);
           }
         }
         else if (y < height)
         {
-          block.set_type(Block::Type::Dirt);
+          set_block_type(x, y, z, Block::Type::Dirt);
         }
-        else if (y <= water_level_)
+        else if (y <= water_level)
         {
-          block.set_type(Block::Type::Water);
+          set_block_type(x, y, z, Block::Type::Water);
         }
       }
     }
   }
+  blocks_.compact();
   is_generated_ = true;
+  is_modified_  = true;
 }
 
-[[nodiscard]] bool Chunk::is_mesh_generated() const
+[[nodiscard]] bool Chunk::is_decorated() const { return is_decorated_; }
+
+void Chunk::set_decorated()
 {
-  return is_mesh_generated_;
+  assert(is_generated() && !is_compressed_);
+  is_decorated_  = true;
+  is_decorating_ = false;
+  is_modified_   = true;
 }
 
-bool Chunk::is_block(const glm::ivec3 &position, Block::Type type) const
+[[nodiscard]] bool Chunk::is_decorating() const { return is_decorating_; }
+
+void Chunk::set_decorating(bool value) { is_decorating_ = value; }
+
+bool Chunk::place_decoration_block(const glm::ivec3 &position,
+                                   Block::Type       type,
+                                   bool              is_replacing)
 {
-  if (!is_valid_block_position(position))
-  {
-    return false;
-  }
+  assert(is_generated() && !is_compressed_);
+  assert(is_valid_block_position(position));
 
-  const auto &other_block_type =
-      blocks_[position.x][position.z][position.y].type();
-  if (type == Block::Type::Water)
+  const auto old_type = blocks_.type(position.x, position.y, position.z);
+  if (old_type == type || (!is_replacing && old_type != Block::Type::Air))
   {
-    return other_block_type != Block::Type::Air;
+    return false;
   }
 
-  return other_block_type != Block::Type::Air &&
-         other_block_type != Block::Type::Water;
+  set_block_type(position.x, position.y, position.z, type);
+  is_modified_ = true;
+  return true;
 }
 
-bool Chunk::is_block(const glm::ivec3 &position,
-                     const World      &world,
-                     Block::Type       type) const
+void Chunk::load(ByteSpan data)
 {
-  if (is_valid_block_position(position))
-  {
-    return is_block(position, type);
-  }
-  const auto world_position = block_position_to_world_position(position);
-  return world.is_block(world_position, type);
-}
-
-void Chunk::generate_mesh_data(const World            &world,
-                               std::vector<glm::vec3> &block_positions,
-                               std::vector<glm::vec3> &block_normals,
-                               std::vector<glm::vec2> &block_tex_coords,
-                               std::vector<int>       &block_tex_indices,
-                               std::vector<unsigned>  &block_indices,
-                               std::vector<glm::vec3> &water_positions,
-                               std::vector<glm::vec3> &water_normals,
-                               std::vector<glm::vec2> &water_tex_coords,
-                               std::vector<int>       &water_tex_indices,
-                               std::vector<unsigned>  &water_indices)
-{
-  int current_index_block = 0;
-  int current_index_water = 0;
-  for (std::size_t x = 0; x < blocks_.size(); ++x)
-  {
-    for (std::size_t z = 0; z < blocks_[x].size(); ++z)
-    {
-      for (std::size_t y = 0; y < blocks_[x][z].size(); ++y)
+  assert(is_assigned_ && !is_generated_);
+
+  is_decorated_ = decode_chunk_blocks(
+      data,
+      width(),
+      height(),
+      [this](const BlockRun &run)
       {
-        const auto block_type = blocks_[x][z][y].type();
-        const auto block_height =
-            block_type == Block::Type::Water ? 0.9f : 1.0f;
-
-        auto positions     = &block_positions;
-        auto normals       = &block_normals;
-        auto tex_coords    = &block_tex_coords;
-        auto tex_indices   = &block_tex_indices;
-        auto indices       = &block_indices;
-        auto current_index = &current_index_block;
-
-        if (block_type == Block::Type::Air)
+        // The chunk was reset to air
+        if (run.type == Block::Type::Air)
         {
-          continue;
+          return;
         }
-        else if (block_type == Block::Type::Water)
+        for (int y = run.y; y < run.y + run.length; ++y)
         {
-          positions     = &water_positions;
-          normals       = &water_normals;
-          tex_coords    = &water_tex_coords;
-          tex_indices   = &water_tex_indices;
-          indices       = &water_indices;
-          current_index = &current_index_water;
+          set_block_type(run.x, y, run.z, run.type);
         }
+      });
+  blocks_.compact();
+  is_generated_ = true;
+}
 
-        // Front
-        if (!is_block(glm::ivec3{x, y, z + 1}, world, block_type))
-        {
-          positions->emplace_back(x + 0.0f, y + block_height, z + 1.0f);
-          positions->emplace_back(x + 0.0f, y + 0.0f, z + 1.0f);
-          positions->emplace_back(x + 1.0f, y + 0.0f, z + 1.0f);
-          positions->emplace_back(x + 1.0f, y + block_height, z + 1.0f);
-
-          normals->emplace_back(0.0f, 0.0f, 1.0f);
-          normals->emplace_back(0.0f, 0.0f, 1.0f);
-          normals->emplace_back(0.0f, 0.0f, 1.0f);
-          normals->emplace_back(0.0f, 0.0f, 1.0f);
-
-          tex_coords->emplace_back(0.0f, 1.0f);
-          tex_coords->emplace_back(0.0f, 0.0f);
-          tex_coords->emplace_back(1.0f, 0.0f);
-          tex_coords->emplace_back(1.0f, 1.0f);
-
-          const auto tex_index =
-              world.block_texture_index(block_type, Block::Side::Front);
-          tex_indices->push_back(tex_index);
-          tex_indices->push_back(tex_index);
-          tex_indices->push_back(tex_index);
-          tex_indices->push_back(tex_index);
-
-          indices->push_back(*current_index + 0);
-          indices->push_back(*current_index + 1);
-          indices->push_back(*current_index + 2);
-          indices->push_back(*current_index + 2);
-          indices->push_back(*current_index + 3);
-          indices->push_back(*current_index + 0);
-          *current_index += 4;
-        }
+[[nodiscard]] bool Chunk::is_compressed() const { return is_compressed_; }
 
-        // Back
-        if (!is_block(glm::ivec3{x, y, z - 1}, world, block_type))
-        {
-          positions->emplace_back(x + 0.0f, y + block_height, z + 0.0f);
-          positions->emplace_back(x + 1.0f, y + block_height, z + 0.0f);
-          positions->emplace_back(x + 1.0f, y + 0.0f, z + 0.0f);
-          positions->emplace_back(x + 0.0f, y + 0.0f, z + 0.0f);
-
-          normals->emplace_back(0.0f, 0.0f, -1.0f);
-          normals->emplace_back(0.0f, 0.0f, -1.0f);
-          normals->emplace_back(0.0f, 0.0f, -1.0f);
-          normals->emplace_back(0.0f, 0.0f, -1.0f);
-
-          tex_coords->emplace_back(1.0f, 1.0f);
-          tex_coords->emplace_back(0.0f, 1.0f);
-          tex_coords->emplace_back(0.0f, 0.0f);
-          tex_coords->emplace_back(1.0f, 0.0f);
-
-          const auto tex_index =
-              world.block_texture_index(block_type, Block::Side::Back);
-          tex_indices->push_back(tex_index);
-          tex_indices->push_back(tex_index);
-          tex_indices->push_back(tex_index);
-          tex_indices->push_back(tex_index);
-
-          indices->push_back(*current_index + 0);
-          indices->push_back(*current_index + 1);
-          indices->push_back(*current_index + 2);
-          indices->push_back(*current_index + 2);
-          indices->push_back(*current_index + 3);
-          indices->push_back(*current_index + 0);
-          *current_index += 4;
-        }
+void Chunk::compress()
+{
+  assert(is_generated() && !is_compressed_);
 
-        // Top
-        if (!is_block(glm::ivec3{x, y + 1, z}, world, block_type))
-        {
-          positions->emplace_back(x + 0.0f, y + block_height, z + 1.0f);
-          positions->emplace_back(x + 1.0f, y + block_height, z + 1.0f);
-          positions->emplace_back(x + 1.0f, y + block_height, z + 0.0f);
-          positions->emplace_back(x + 0.0f, y + block_height, z + 0.0f);
-
-          normals->emplace_back(0.0f, 1.0f, 0.0f);
-          normals->emplace_back(0.0f, 1.0f, 0.0f);
-          normals->emplace_back(0.0f, 1.0f, 0.0f);
-          normals->emplace_back(0.0f, 1.0f, 0.0f);
-
-          tex_coords->emplace_back(0.0f, 0.0f);
-          tex_coords->emplace_back(1.0f, 0.0f);
-          tex_coords->emplace_back(1.0f, 1.0f);
-          tex_coords->emplace_back(0.0f, 1.0f);
-
-          const auto tex_index =
-              world.block_texture_index(block_type, Block::Side::Top);
-          tex_indices->push_back(tex_index);
-          tex_indices->push_back(tex_index);
-          tex_indices->push_back(tex_index);
-          tex_indices->push_back(tex_index);
-
-          indices->push_back(*current_index + 0);
-          indices->push_back(*current_index + 1);
-          indices->push_back(*current_index + 2);
-          indices->push_back(*current_index + 2);
-          indices->push_back(*current_index + 3);
-          indices->push_back(*current_index + 0);
-          *current_index += 4;
-        }
+  compressed_blocks_ = encode_chunk_blocks(blocks_, is_decorated_);
+  blocks_.release();
+  is_compressed_ = true;
+}
 
-        // Bottom
-        if (!is_block(glm::ivec3{x, y - 1, z}, world, block_type))
-        {
-          positions->emplace_back(x + 0.0f, y + 0.0f, z + 1.0f);
-          positions->emplace_back(x + 0.0f, y + 0.0f, z + 0.0f);
-          positions->emplace_back(x + 1.0f, y + 0.0f, z + 0.0f);
-          positions->emplace_back(x + 1.0f, y + 0.0f, z + 1.0f);
-
-          normals->emplace_back(0.0f, -1.0f, 0.0f);
-          normals->emplace_back(0.0f, -1.0f, 0.0f);
-          normals->emplace_back(0.0f, -1.0f, 0.0f);
-          normals->emplace_back(0.0f, -1.0f, 0.0f);
-
-          tex_coords->emplace_back(0.0f, 1.0f);
-          tex_coords->emplace_back(0.0f, 0.0f);
-          tex_coords->emplace_back(1.0f, 0.0f);
-          tex_coords->emplace_back(1.0f, 1.0f);
-
-          const auto tex_index =
-              world.block_texture_index(block_type, Block::Side::Bottom);
-          tex_indices->push_back(tex_index);
-          tex_indices->push_back(tex_index);
-          tex_indices->push_back(tex_index);
-          tex_indices->push_back(tex_index);
-
-          indices->push_back(*current_index + 0);
-          indices->push_back(*current_index + 1);
-          indices->push_back(*current_index + 2);
-          indices->push_back(*current_index + 2);
-          indices->push_back(*current_index + 3);
-          indices->push_back(*current_index + 0);
-          *current_index += 4;
-        }
+void Chunk::decompress()
+{
+  assert(is_compressed_);
 
-        // Left
-        if (!is_block(glm::ivec3{x - 1, y, z}, world, block_type))
-        {
-          positions->emplace_back(x + 0.0f, y + 0.0f, z + 1.0f);
-          positions->emplace_back(x + 0.0f, y + block_height, z + 1.0f);
-          positions->emplace_back(x + 0.0f, y + block_height, z + 0.0f);
-          positions->emplace_back(x + 0.0f, y + 0.0f, z + 0.0f);
-
-          normals->emplace_back(-1.0f, 0.0f, 0.0f);
-          normals->emplace_back(-1.0f, 0.0f, 0.0f);
-          normals->emplace_back(-1.0f, 0.0f, 0.0f);
-          normals->emplace_back(-1.0f, 0.0f, 0.0f);
-
-          tex_coords->emplace_back(1.0f, 0.0f);
-          tex_coords->emplace_back(1.0f, 1.0f);
-          tex_coords->emplace_back(0.0f, 1.0f);
-          tex_coords->emplace_back(0.0f, 0.0f);
-
-          const auto tex_index =
-              world.block_texture_index(block_type, Block::Side::Left);
-          tex_indices->push_back(tex_index);
-          tex_indices->push_back(tex_index);
-          tex_indices->push_back(tex_index);
-          tex_indices->push_back(tex_index);
-
-          indices->push_back(*current_index + 0);
-          indices->push_back(*current_index + 1);
-          indices->push_back(*current_index + 2);
-          indices->push_back(*current_index + 2);
-          indices->push_back(*current_index + 3);
-          indices->push_back(*current_index + 0);
-          *current_index += 4;
-        }
+  // The sections still count the blocks, so they are not updated
+  blocks_ = decompressed_blocks();
 
-        // Right
-        if (!is_block(glm::ivec3{x + 1, y, z}, world, block_type))
-        {
-          positions->emplace_back(x + 1.0f, y + 0.0f, z + 1.0f);
-          positions->emplace_back(x + 1.0f, y + 0.0f, z + 0.0f);
-          positions->emplace_back(x + 1.0f, y + block_height, z + 0.0f);
-          positions->emplace_back(x + 1.0f, y + block_height, z + 1.0f);
-
-          normals->emplace_back(1.0f, 0.0f, 0.0f);
-          normals->emplace_back(1.0f, 0.0f, 0.0f);
-          normals->emplace_back(1.0f, 0.0f, 0.0f);
-          normals->emplace_back(1.0f, 0.0f, 0.0f);
-
-          tex_coords->emplace_back(0.0f, 0.0f);
-          tex_coords->emplace_back(1.0f, 0.0f);
-          tex_coords->emplace_back(1.0f, 1.0f);
-          tex_coords->emplace_back(0.0f, 1.0f);
-
-          const auto tex_index =
-              world.block_texture_index(block_type, Block::Side::Right);
-          tex_indices->push_back(tex_index);
-          tex_indices->push_back(tex_index);
-          tex_indices->push_back(tex_index);
-          tex_indices->push_back(tex_index);
-
-          indices->push_back(*current_index + 0);
-          indices->push_back(*current_index + 1);
-          indices->push_back(*current_index + 2);
-          indices->push_back(*current_index + 2);
-          indices->push_back(*current_index + 3);
-          indices->push_back(*current_index + 0);
-          *current_index += 4;
-        }
-      }
-    }
-  }
+  decltype(compressed_blocks_){}.swap(compressed_blocks_);
+  is_compressed_ = false;
 }
 
-void Chunk::fill_mesh_data(const World &world)
-{
-  std::vector<glm::vec3> positions;
-  std::vector<glm::vec3> normals;
-  std::vector<glm::vec2> tex_coords;
-  std::vector<int>       tex_indices;
-  std::vector<unsigned>  indices;
-
-  std::vector<glm::vec3> water_positions;
-  std::vector<glm::vec3> water_normals;
-  std::vector<glm::vec2> water_tex_coords;
-  std::vector<int>       water_tex_indices;
-  std::vector<unsigned>  water_indices;
-
-  generate_mesh_data(world,
-                     positions,
-                     normals,
-                     tex_coords,
-                     tex_indices,
-                     indices,
-                     water_positions,
-                     water_normals,
-                     water_tex_coords,
-                     water_tex_indices,
-                     water_indices);
-
-  send_mesh_data_to_gpu(positions,
-                        normals,
-                        tex_coords,
-                        tex_indices,
-                        indices,
-                        water_positions,
-                        water_normals,
-                        water_tex_coords,
-                        water_tex_indices,
-                        water_indices);
-}
-
-void Chunk::send_mesh_data_to_gpu(
-    const std::vector<glm::vec3> &block_positions,
-    const std::vector<glm::vec3> &block_normals,
-    const std::vector<glm::vec2> &block_tex_coords,
-    const std::vector<int>       &block_tex_indices,
-    const std::vector<unsigned>  &block_indices,
-    const std::vector<glm::vec3> &water_positions,
-    const std::vector<glm::vec3> &water_normals,
-    const std::vector<glm::vec2> &water_tex_coords,
-    const std::vector<int>       &water_tex_indices,
-    const std::vector<unsigned>  &water_indices)
+ByteSpan Chunk::compressed_blocks() const
 {
-  {
-    GlVertexBufferLayout vec3_layout;
-    vec3_layout.push_float(3);
-    vertex_buffer_positions_->set_data(block_positions, vec3_layout);
-    vertex_buffer_normals_->set_data(block_normals, vec3_layout);
-    vertex_buffer_water_positions_->set_data(water_positions, vec3_layout);
-    vertex_buffer_water_normals_->set_data(water_normals, vec3_layout);
-  }
+  assert(is_compressed_);
+  return compressed_blocks_;
+}
 
-  {
-    GlVertexBufferLayout int_layout;
-    int_layout.push_int(1);
-    vertex_buffer_tex_indices_->set_data(block_tex_indices, int_layout);
-    vertex_buffer_water_tex_indices_->set_data(water_tex_indices, int_layout);
-  }
+[[nodiscard]] bool Chunk::is_modified() const { return is_modified_; }
 
-  {
-    GlVertexBufferLayout vec2_layout;
-    vec2_layout.push_float(2);
-    vertex_buffer_tex_coords_->set_data(block_tex_coords, vec2_layout);
-    vertex_buffer_water_tex_coords_->set_data(water_tex_coords, vec2_layout);
-  }
+void Chunk::set_saved() { is_modified_ = false; }
+
+[[nodiscard]] bool Chunk::is_mesh_generated() const
+{
+  return is_mesh_generated_;
+}
+
+unsigned Chunk::mesh_revision() const { return mesh_revision_; }
 
-  index_buffer_->set_data(block_indices);
-  water_index_buffer_->set_data(water_indices);
+unsigned Chunk::next_mesh_revision()
+{
+  is_mesh_requested_ = true;
+  mesh_revision_     = next_revision();
+  return mesh_revision_;
 }
 
-void Chunk::regenerate_mesh(const World &world) { fill_mesh_data(world); }
+[[nodiscard]] bool Chunk::is_mesh_requested() const
+{
+  return is_mesh_requested_;
+}
 
-void Chunk::generate_mesh(const World &world)
+void Chunk::upload_mesh(const ChunkMeshData &mesh_data)
 {
-  if (is_mesh_generated_)
+  // Buffers survive reset(), so a recycled chunk reuses them
+  if (!vertex_buffer_)
   {
-    return;
+    vertex_buffer_       = std::make_unique<GlVertexBuffer>();
+    index_buffer_        = std::make_unique<GlIndexBuffer>();
+    water_vertex_buffer_ = std::make_unique<GlVertexBuffer>();
+    water_index_buffer_  = std::make_unique<GlIndexBuffer>();
+
+    vertex_buffers_.push_back(vertex_buffer_.get());
+    water_vertex_buffers_.push_back(water_vertex_buffer_.get());
   }
   is_mesh_generated_ = true;
 
-  if (!vertex_buffer_positions_)
-  {
-    vertex_buffer_positions_ = std::make_unique<GlVertexBuffer>();
-  }
-  if (!vertex_buffer_normals_)
-  {
-    vertex_buffer_normals_ = std::make_unique<GlVertexBuffer>();
-  }
-  if (!vertex_buffer_tex_coords_)
-  {
-    vertex_buffer_tex_coords_ = std::make_unique<GlVertexBuffer>();
-  }
-  if (!vertex_buffer_tex_indices_)
-  {
-    vertex_buffer_tex_indices_ = std::make_unique<GlVertexBuffer>();
-  }
-  if (!index_buffer_)
-  {
-    index_buffer_ = std::make_unique<GlIndexBuffer>();
-  }
+  GlVertexBufferLayout layout;
+  layout.push_uint(2);
+  vertex_buffer_->set_data(mesh_data.vertices, layout);
+  water_vertex_buffer_->set_data(mesh_data.water_vertices, layout);
 
-  vertex_buffers_.push_back(vertex_buffer_positions_.get());
-  vertex_buffers_.push_back(vertex_buffer_normals_.get());
-  vertex_buffers_.push_back(vertex_buffer_tex_coords_.get());
-  vertex_buffers_.push_back(vertex_buffer_tex_indices_.get());
+  index_buffer_->set_data(mesh_data.indices);
+  water_index_buffer_->set_data(mesh_data.water_indices);
 
-  if (!vertex_buffer_water_positions_)
-  {
-    vertex_buffer_water_positions_ = std::make_unique<GlVertexBuffer>();
-  }
-  if (!vertex_buffer_water_normals_)
-  {
-    vertex_buffer_water_normals_ = std::make_unique<GlVertexBuffer>();
-  }
-  if (!vertex_buffer_water_tex_coords_)
-  {
-    vertex_buffer_water_tex_coords_ = std::make_unique<GlVertexBuffer>();
-  }
-  if (!vertex_buffer_water_tex_indices_)
-  {
-    vertex_buffer_water_tex_indices_ = std::make_unique<GlVertexBuffer>();
-  }
-  if (!water_index_buffer_)
-  {
-    water_index_buffer_ = std::make_unique<GlIndexBuffer>();
-  }
+  face_count_ = mesh_data.face_count;
+  quad_count_ = mesh_data.quad_count;
+}
 
-  water_vertex_buffers_.push_back(vertex_buffer_water_positions_.get());
-  water_vertex_buffers_.push_back(vertex_buffer_water_normals_.get());
-  water_vertex_buffers_.push_back(vertex_buffer_water_tex_coords_.get());
-  water_vertex_buffers_.push_back(vertex_buffer_water_tex_indices_.get());
+void Chunk::regenerate_mesh(const World &world)
+{
+  next_mesh_revision();
 
-  fill_mesh_data(world);
+  // Reused, so re-meshing keeps the capacity of the last mesh
+  thread_local ChunkMeshData mesh_data;
+  world.chunk_mesher().mesh(ChunkSnapshot{*this, world}, mesh_data);
+  upload_mesh(mesh_data);
 }
 
 void Chunk::draw(GlShader &shader)
 {
-  assert(vertex_buffer_positions_ != nullptr &&
-         vertex_buffer_normals_ != nullptr &&
-         vertex_buffer_tex_coords_ != nullptr && index_buffer_ != nullptr);
+  assert(vertex_buffer_ != nullptr && index_buffer_ != nullptr);
   if (index_buffer_->count() == 0)
   {
     return;
@@ -686,12 +298,137 @@ void Chunk::draw_water(GlShader &shader)
 
 glm::ivec3 Chunk::position() const { return position_; }
 
+const ChunkBlockStorage &Chunk::blocks() const
+{
+  assert(!is_compressed_);
+  return blocks_;
+}
+
+ChunkBlockStorage Chunk::decompressed_blocks() const
+{
+  if (!is_compressed_)
+  {
+    return blocks_;
+  }
+
+  ChunkBlockStorage blocks{width(), height()};
+  decode_chunk_blocks(compressed_blocks_,
+                      width(),
+                      height(),
+                      [&blocks](const BlockRun &run)
+                      {
+                        if (run.type == Block::Type::Air)
+                        {
+                          return;
+                        }
+                        for (int y = run.y; y < run.y + run.length; ++y)
+                        {
+                          blocks.set_type(run.x, y, run.z, run.type);
+                        }
+                      });
+  blocks.compact();
+  return blocks;
+}
+
+int Chunk::mesh_face_count() const { return face_count_; }
+
+int Chunk::mesh_quad_count() const { return quad_count_; }
+
+std::size_t Chunk::mesh_memory_usage() const
+{
+  std::size_t usage = 0;
+  for (const auto &vertex_buffer : {vertex_buffer_.get(),
+                                    water_vertex_buffer_.get()})
+  {
+    if (vertex_buffer)
+    {
+      usage += vertex_buffer->count() * sizeof(ChunkVertex);
+    }
+  }
+  for (const auto &index_buffer : {index_buffer_.get(),
+                                   water_index_buffer_.get()})
+  {
+    if (index_buffer)
+    {
+      usage += index_buffer->count() * sizeof(unsigned);
+    }
+  }
+  return usage;
+}
+
 Block::Type Chunk::block_type(const glm::ivec3 &position) const
 {
   assert(
       is_valid_block_position(glm::ivec3{position.x, position.y, position.z}));
 
-  return blocks_[position.x][position.z][position.y].type();
+  if (is_section_empty(position.y / section_height))
+  {
+    return Block::Type::Air;
+  }
+  return blocks_.type(position.x, position.y, position.z);
+}
+
+bool Chunk::is_section_empty(int section) const
+{
+  assert(0 <= section && section < section_count());
+  return sections_[section].block_count == 0;
+}
+
+bool Chunk::is_section_solid(int section) const
+{
+  assert(0 <= section && section < section_count());
+  return sections_[section].solid_count == section_volume(section);
+}
+
+int Chunk::section_volume(int section) const
+{
+  const auto section_begin = section * section_height;
+  const auto section_end   = std::min(section_begin + section_height, height());
+  return width() * width() * (section_end - section_begin);
+}
+
+bool Chunk::is_section_buried(const std::array<const Chunk *, 4> &neighbours,
+                              int section) const
+{
+  // Faces of a solid section can only be seen through its border, so all six
+  // neighbouring sections need to be solid too. There is nothing below the
+  // first and above the last section, so these always show faces.
+  if (!is_section_solid(section) || section == 0 ||
+      section == section_count() - 1 || !is_section_solid(section - 1) ||
+      !is_section_solid(section + 1))
+  {
+    return false;
+  }
+
+  return std::all_of(neighbours.begin(),
+                     neighbours.end(),
+                     [section](const Chunk *neighbour)
+                     {
+                       return neighbour != nullptr &&
+                              neighbour->is_section_solid(section);
+                     });
+}
+
+void Chunk::set_block_type(int x, int y, int z, Block::Type type)
+{
+  const auto old_type = blocks_.type(x, y, z);
+  if (old_type == type)
+  {
+    return;
+  }
+
+  auto &section = sections_[y / section_height];
+  section.block_count += (type != Block::Type::Air) -
+                         (old_type != Block::Type::Air);
+  section.solid_count += Block::is_opaque(type) - Block::is_opaque(old_type);
+
+  blocks_.set_type(x, y, z, type);
+}
+
+std::size_t Chunk::memory_usage() const
+{
+  return sizeof(*this) - sizeof(blocks_) + blocks_.memory_usage() +
+         compressed_blocks_.capacity();
 }
 
 bool Chunk::is_valid_block_position(const glm::ivec3 &position) const
@@ -700,9 +437,8 @@ bool Chunk::is_valid_block_position(const glm::ivec3 &position) const
   const auto y = position.y;
   const auto z = position.z;
 
-  return ((0 <= x && x < static_cast<int>(blocks_.size())) &&
-          (0 <= z && z < static_cast<int>(blocks_[x].size())) &&
-          (0 <= y && y < static_cast<int>(blocks_[x][z].size())));
+  return ((0 <= x && x < width()) && (0 <= z && z < width()) &&
+          (0 <= y && y < height()));
 }
 
 bool Chunk::remove_block(World &world, const glm::ivec3 &position)
@@ -712,61 +448,55 @@ bool Chunk::remove_block(World &world, const glm::ivec3 &position)
     return false;
   }
 
-  auto &block = blocks_[position.x][position.z][position.y];
-
-  if (block.type() == Block::Type::Air || block.type() == Block::Type::Water)
+  // Air and water can not be removed
+  const auto block_type = blocks_.type(position.x, position.y, position.z);
+  if (!Block::is_opaque(block_type))
   {
     return false;
   }
 
-  block.set_type(Block::Type::Air);
-  regenerate_mesh(world);
+  set_block_type(position.x, position.y, position.z, Block::Type::Air);
+  is_modified_ = true;
+  world.mark_chunk_dirty(position_);
   regenerate_chunks_if_border_block(world, position);
 
   return true;
 }
 
-Block &Chunk::block(const glm::ivec3 &position)
-{
-  assert(is_valid_block_position(position));
-  return blocks_[position.x][position.z][position.y];
-}
-
 void Chunk::regenerate_chunks_if_border_block(World            &world,
                                               const glm::ivec3 &position)
 {
   // TODO: Optimize check if neighbour block is solid
   if (position.x == 0)
   {
-    world.regenerate_chunk(
+    world.mark_chunk_dirty(
         glm::ivec3{position_.x - 1, position_.y, position_.z});
   }
-  else if (position.x == static_cast<int>(blocks_.size() - 1))
+  else if (position.x == width() - 1)
   {
-    world.regenerate_chunk(
+    world.mark_chunk_dirty(
         glm::ivec3{position_.x + 1, position_.y, position_.z});
   }
 
   if (position.z == 0)
   {
-    world.regenerate_chunk(
+    world.mark_chunk_dirty(
         glm::ivec3{position_.x, position_.y, position_.z - 1});
   }
-  else if (position.z == static_cast<int>(blocks_[position.x].size() - 1))
+  else if (position.z == width() - 1)
   {
-    world.regenerate_chunk(
+    world.mark_chunk_dirty(
         glm::ivec3{position_.x, position_.y, position_.z + 1});
   }
 
   if (position.y == 0)
   {
-    world.regenerate_chunk(
+    world.mark_chunk_dirty(
         glm::ivec3{position_.x, position_.y - 1, position_.z});
   }
-  else if (position.y ==
-           static_cast<int>(blocks_[position.x][position.z].size() - 1))
+  else if (position.y == height() - 1)
   {
-    world.regenerate_chunk(
+    world.mark_chunk_dirty(
         glm::ivec3{position_.x, position_.y + 1, position_.z});
   }
 }
@@ -796,11 +526,39 @@ bool Chunk::place_block(World            &world,
     return false;
   }
 
-  auto &block = blocks_[position.x][position.z][position.y];
-  block.set_type(block_type);
+  set_block_type(position.x, position.y, position.z, block_type);
+  is_modified_ = true;
 
-  regenerate_mesh(world);
+  world.mark_chunk_dirty(position_);
   regenerate_chunks_if_border_block(world, position);
 
   return true;
 }
+
+std::size_t ChunkPositionHash::operator()(const glm::ivec3 &position) const
+{
+  // Chunks are columns, so y does not need to be hashed
+  const auto x = static_cast<std::uint32_t>(position.x);
+  const auto z = static_cast<std::uint32_t>(position.z);
+  return std::hash<std::uint64_t>{}((std::uint64_t{x} << 32) | z);
+}
+
+std::pair<glm::ivec3, glm::ivec3>
+world_position_to_chunk_position(const glm::ivec3 &world_position)
+{
+  // Shifting right rounds towards negative infinity, so block -1 is in
+  // chunk -1. The height need not be a power of two.
+  constexpr auto width_mask = Chunk::width() - 1;
+  constexpr auto height     = Chunk::height();
+
+  const auto       y = world_position.y;
+  const glm::ivec3 chunk_position{
+      world_position.x >> Chunk::width_shift,
+      y >= 0 ? y / height : (y - height + 1) / height,
+      world_position.z >> Chunk::width_shift};
+  const glm::ivec3 block_position{world_position.x & width_mask,
+                                  y - chunk_position.y * height,
+                                  world_position.z & width_mask};
+
+  return {chunk_position, block_position};
+}
@@ -1,29 +1,151 @@
 #pragma once
 
 #include "block.hpp"
+#include "block_storage.hpp"
+#include "byte_span.hpp"
 #include "gl/gl_index_buffer.hpp"
 #include "gl/gl_shader.hpp"
 #include "gl/gl_vertex_buffer.hpp"
+#include "palette_block_storage.hpp"
 
 #include <array>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <utility>
+#include <vector>
 
 class World;
+struct ChunkHeightmap;
+struct ChunkMeshData;
+
+// Vertex of a chunk mesh, bit packed into two words. Decoded by
+// blinn_phong.vert and water.vert.
+struct ChunkVertex
+{
+  // x: 8 bits, y: 10 bits, z: 8 bits, face: 3 bits, unused: 2 bits,
+  // lowered top: 1 bit
+  std::uint32_t position;
+  // u: 10 bits, v: 10 bits, texture layer: 12 bits
+  std::uint32_t tex_coord;
+};
+static_assert(sizeof(ChunkVertex) == 8);
+
+// Chunk size in blocks, set with the CMake variables of the same name
+#ifndef CHUNK_WIDTH
+#define CHUNK_WIDTH 16
+#endif
+#ifndef CHUNK_HEIGHT
+#define CHUNK_HEIGHT 256
+#endif
+
+#ifdef CHUNK_PALETTE_STORAGE
+using ChunkBlockStorage = PaletteBlockStorage;
+#else
+using ChunkBlockStorage = BlockStorage;
+#endif
+
+// For maps and sets of chunks by their position
+struct ChunkPositionHash
+{
+  std::size_t operator()(const glm::ivec3 &position) const;
+};
 
 class Chunk
 {
 public:
-  static int width();
-  static int height();
+  // Chunks are split into vertical sections of this many blocks, which are
+  // skipped while meshing if they are empty or buried. The palette storage
+  // compresses the same sections.
+  static constexpr int section_height = PaletteBlockStorage::section_height;
+
+  static constexpr int width() { return CHUNK_WIDTH; }
+  static constexpr int height() { return CHUNK_HEIGHT; }
+  static constexpr int section_count()
+  {
+    return (height() + section_height - 1) / section_height;
+  }
+
+  // Block x and z are split into chunk and block with shifts and masks
+  static constexpr int width_shift = []()
+  {
+    int shift = 0;
+    while ((1 << shift) < CHUNK_WIDTH)
+    {
+      ++shift;
+    }
+    return shift;
+  }();
+  static_assert(1 << width_shift == CHUNK_WIDTH,
+                "CHUNK_WIDTH must be a power of two");
+  static_assert(CHUNK_HEIGHT > 0, "CHUNK_HEIGHT must be positive");
 
   Chunk();
 
+  // Turns the chunk into an empty, not generated chunk at the position, so an
+  // unloaded chunk can be reused for another one. The block storage and the
+  // GPU buffers are kept. Must not be called while the chunk is generating.
+  void reset(const glm::ivec3 &position);
+
+  // False until the chunk got a position with reset()
+  [[nodiscard]] bool is_assigned() const;
+
+  // Generates the terrain. Trees are added later by the decoration pass.
   [[nodiscard]] bool is_generated() const;
   void               generate(const glm::vec3 &position, const World &world);
+  // Same without a world, from the heightmap of the chunk's column
+  void generate(const ChunkHeightmap &heightmap);
+
+  // Whether the trees of the chunk were placed. They can reach into the
+  // neighbours, so this waits until the terrain of all eight neighbours is
+  // generated. Set while a worker computes the trees, the chunk itself is
+  // not touched by the worker.
+  [[nodiscard]] bool is_decorated() const;
+  void               set_decorated();
+  [[nodiscard]] bool is_decorating() const;
+  void               set_decorating(bool value);
+
+  // Places a block of the decoration of this or a neighbouring chunk.
+  // Returns whether the block changed.
+  bool place_decoration_block(const glm::ivec3 &position,
+                              Block::Type       type,
+                              bool              is_replacing);
+
+  // Fills the chunk with blocks that were saved with encode_chunk_blocks()
+  // instead of generating it. Throws std::runtime_error and leaves the chunk
+  // untouched if the data is corrupt.
+  void load(ByteSpan data);
+
+  // Chunks far from the player are kept encoded with encode_chunk_blocks()
+  // to save memory. Their blocks must not be accessed until decompress() is
+  // called, the sections stay valid.
+  [[nodiscard]] bool is_compressed() const;
+  void               compress();
+  void               decompress();
+  ByteSpan           compressed_blocks() const;
+
+  // Whether the blocks changed since the chunk was loaded or saved
+  [[nodiscard]] bool is_modified() const;
+  void               set_saved();
+
+  // Set while a worker thread generates the chunk. The chunk must not be
+  // accessed from elsewhere until this is cleared again.
+  [[nodiscard]] bool is_generating() const;
+  void               set_generating(bool value);
 
   [[nodiscard]] bool is_mesh_generated() const;
 
-  void generate_mesh(const World &world);
+  // Every mesh request gets a new revision, so meshes that were built from
+  // an outdated snapshot or another chunk can be recognized
+  unsigned mesh_revision() const;
+  unsigned next_mesh_revision();
+
+  // Whether a mesh was requested since the last reset
+  [[nodiscard]] bool is_mesh_requested() const;
+
+  void upload_mesh(const ChunkMeshData &mesh_data);
+
+  // Meshes and uploads right away on the calling thread
   void regenerate_mesh(const World &world);
 
   void draw(GlShader &shader);
@@ -31,94 +153,87 @@ public:
 
   glm::ivec3 position() const;
 
+  // Must not be called while the chunk is compressed
+  const ChunkBlockStorage &blocks() const;
+  // Copy of the blocks, decoded if the chunk is compressed
+  ChunkBlockStorage decompressed_blocks() const;
+
+  // Block faces in the last generated mesh and the number of quads that were
+  // emitted for them. These only differ with greedy meshing.
+  int mesh_face_count() const;
+  int mesh_quad_count() const;
+
+  // Bytes of vertex and index data the mesh occupies on the GPU
+  std::size_t mesh_memory_usage() const;
+
   Block::Type block_type(const glm::ivec3 &position) const;
 
+  std::size_t memory_usage() const;
+
+  [[nodiscard]] bool is_section_empty(int section) const;
+  [[nodiscard]] bool is_section_solid(int section) const;
+  // The neighbours are the chunks at -x, +x, -z and +z, null if they are
+  // not generated
+  [[nodiscard]] bool
+  is_section_buried(const std::array<const Chunk *, 4> &neighbours,
+                    int                                 section) const;
+
   bool remove_block(World &world, const glm::ivec3 &position);
   bool
   place_block(World &world, const glm::ivec3 &position, Block::Type block_type);
 
 private:
+  struct Section
+  {
+    // Blocks that are not air
+    int block_count{0};
+    // Blocks that hide the faces of their neighbours
+    int solid_count{0};
+  };
+
   std::vector<const GlVertexBuffer *>          vertex_buffers_;
   std::vector<const GlVertexBuffer *>          water_vertex_buffers_;
-  std::vector<std::vector<std::vector<Block>>> blocks_;
+  ChunkBlockStorage                            blocks_;
+  std::vector<Section>                         sections_;
+  std::vector<std::uint8_t>                    compressed_blocks_;
 
   glm::ivec3 position_{};
 
-  float c1_;
-  float c2_;
-  float c3_;
-  float div_;
-  float frequency1_;
-  float frequency2_;
-  float frequency3_;
-  float e_;
-  float fudge_factor_;
-  float water_level_ = 5.0f;
-  float terraces_;
-
-  int min_tree_height_;
-  int max_tree_height_;
-
-  int min_leaves_radius_;
-  int max_leaves_radius_;
-
-  int tree_density_;
-  int leave_density_;
-
+  bool is_assigned_       = false;
+  bool is_generating_     = false;
   bool is_generated_      = false;
+  bool is_decorating_     = false;
+  bool is_decorated_      = false;
+  bool is_modified_       = false;
+  bool is_compressed_     = false;
+  bool is_mesh_requested_ = false;
   bool is_mesh_generated_ = false;
 
-  std::unique_ptr<GlVertexBuffer> vertex_buffer_positions_{};
-  std::unique_ptr<GlVertexBuffer> vertex_buffer_normals_{};
-  std::unique_ptr<GlVertexBuffer> vertex_buffer_tex_coords_{};
-  std::unique_ptr<GlVertexBuffer> vertex_buffer_tex_indices_{};
+  unsigned mesh_revision_ = 0;
+
+  int face_count_ = 0;
+  int quad_count_ = 0;
 
-  std::unique_ptr<GlVertexBuffer> vertex_buffer_water_positions_{};
-  std::unique_ptr<GlVertexBuffer> vertex_buffer_water_normals_{};
-  std::unique_ptr<GlVertexBuffer> vertex_buffer_water_tex_coords_{};
-  std::unique_ptr<GlVertexBuffer> vertex_buffer_water_tex_indices_{};
+  std::unique_ptr<GlVertexBuffer> vertex_buffer_{};
+  std::unique_ptr<GlVertexBuffer> water_vertex_buffer_{};
 
   std::unique_ptr<GlIndexBuffer> index_buffer_{};
   std::unique_ptr<GlIndexBuffer> water_index_buffer_{};
 
-  [[nodiscard]] bool is_block(const glm::ivec3 &position,
-                              Block::Type       type) const;
-  [[nodiscard]] bool is_block(const glm::ivec3 &position,
-                              const World      &world,
-                              Block::Type       type) const;
+  void set_block_type(int x, int y, int z, Block::Type type);
 
-  void fill_mesh_data(const World &world);
+  int section_volume(int section) const;
 
   bool is_valid_block_position(const glm::ivec3 &position) const;
 
-  Block &block(const glm::ivec3 &position);
-
   glm::ivec3
   block_position_to_world_position(const glm::ivec3 &block_position) const;
 
   void regenerate_chunks_if_border_block(World            &world,
                                          const glm::ivec3 &position);
-
-  void send_mesh_data_to_gpu(const std::vector<glm::vec3> &block_positions,
-                             const std::vector<glm::vec3> &block_normals,
-                             const std::vector<glm::vec2> &block_tex_coords,
-                             const std::vector<int>       &block_tex_indices,
-                             const std::vector<unsigned>  &block_indices,
-                             const std::vector<glm::vec3> &water_positions,
-                             const std::vector<glm::vec3> &water_normals,
-                             const std::vector<glm::vec2> &water_tex_coords,
-                             const std::vector<int>       &water_tex_indices,
-                             const std::vector<unsigned>  &water_indices);
-
-  void generate_mesh_data(const World            &world,
-                          std::vector<glm::vec3> &block_positions,
-                          std::vector<glm::vec3> &block_normals,
-                          std::vector<glm::vec2> &block_tex_coords,
-                          std::vector<int>       &block_tex_indices,
-                          std::vector<unsigned>  &block_indices,
-                          std::vector<glm::vec3> &water_positions,
-                          std::vector<glm::vec3> &water_normals,
-                          std::vector<glm::vec2> &water_tex_coords,
-                          std::vector<int>       &water_tex_indices,
-                          std::vector<unsigned>  &water_indices);
 };
+
+// Splits a block position in the world into the position of its chunk and
+// the position of the block in the chunk
+std::pair<glm::ivec3, glm::ivec3>
+world_position_to_chunk_position(const glm::ivec3 &world_position);
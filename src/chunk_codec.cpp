@@ -0,0 +1,206 @@
+#include "chunk_codec.hpp"
+#include "lz_compression.hpp"
+
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+// Version 1 stores the runs directly, version 2 compresses them and version
+// 3 adds the flags
+constexpr std::uint8_t run_format_version = 1;
+constexpr std::uint8_t lz_format_version  = 2;
+constexpr std::uint8_t format_version     = 3;
+
+constexpr std::uint8_t decorated_flag = 1;
+
+// Version, width, height and flags
+constexpr std::size_t header_size = 6;
+
+// Values are stored little endian, independent of the platform
+void write_u16(std::vector<std::uint8_t> &data, unsigned value)
+{
+  data.push_back(value & 0xff);
+  data.push_back((value >> 8) & 0xff);
+}
+
+void write_u32(std::vector<std::uint8_t> &data, std::uint32_t value)
+{
+  write_u16(data, value & 0xffff);
+  write_u16(data, value >> 16);
+}
+
+class Reader
+{
+public:
+  explicit Reader(ByteSpan data) : data_{data} {}
+
+  [[nodiscard]] bool is_at_end() const { return position_ == data_.size; }
+
+  [[nodiscard]] ByteSpan remaining() const
+  {
+    return {data_.data + position_, data_.size - position_};
+  }
+
+  std::uint8_t read_u8()
+  {
+    if (position_ + 1 > data_.size)
+    {
+      throw std::runtime_error("Chunk data ends unexpectedly");
+    }
+    return data_.data[position_++];
+  }
+
+  unsigned read_u16()
+  {
+    const unsigned low = read_u8();
+    return low | (read_u8() << 8);
+  }
+
+  std::uint32_t read_u32()
+  {
+    const std::uint32_t low = read_u16();
+    return low | (static_cast<std::uint32_t>(read_u16()) << 16);
+  }
+
+private:
+  ByteSpan    data_;
+  std::size_t position_ = 0;
+};
+
+// Appends the columns as (type, length) runs
+void write_runs(std::vector<std::uint8_t> &data,
+                const ChunkBlockStorage   &blocks)
+{
+  for (int x = 0; x < blocks.width(); ++x)
+  {
+    for (int z = 0; z < blocks.width(); ++z)
+    {
+      int y = 0;
+      while (y < blocks.height())
+      {
+        const auto type   = blocks.type(x, y, z);
+        int        length = 1;
+        while (y + length < blocks.height() &&
+               blocks.type(x, y + length, z) == type)
+        {
+          ++length;
+        }
+
+        data.push_back(static_cast<std::uint8_t>(type));
+        write_u16(data, length);
+        y += length;
+      }
+    }
+  }
+}
+
+void read_runs(ByteSpan                                     data,
+               int                                          width,
+               int                                          height,
+               const std::function<void(const BlockRun &)> *function)
+{
+  Reader reader{data};
+  for (int x = 0; x < width; ++x)
+  {
+    for (int z = 0; z < width; ++z)
+    {
+      int y = 0;
+      while (y < height)
+      {
+        const auto type   = reader.read_u8();
+        const int  length = reader.read_u16();
+        if (type > static_cast<std::uint8_t>(Block::Type::Air) ||
+            length == 0 || y + length > height)
+        {
+          throw std::runtime_error("Chunk data is corrupt");
+        }
+
+        if (function != nullptr)
+        {
+          (*function)({x, y, z, length, static_cast<Block::Type>(type)});
+        }
+        y += length;
+      }
+    }
+  }
+
+  if (!reader.is_at_end())
+  {
+    throw std::runtime_error("Chunk data is corrupt");
+  }
+}
+} // namespace
+
+std::vector<std::uint8_t> encode_chunk_blocks(const ChunkBlockStorage &blocks,
+                                              bool is_decorated)
+{
+  // Reused, chunks are encoded on the I/O thread and on the main thread
+  thread_local std::vector<std::uint8_t> runs;
+  runs.clear();
+  write_runs(runs, blocks);
+  const auto compressed_runs = lz_compress(runs);
+
+  std::vector<std::uint8_t> data;
+  data.reserve(header_size + sizeof(std::uint32_t) + compressed_runs.size());
+  data.push_back(format_version);
+  write_u16(data, blocks.width());
+  write_u16(data, blocks.height());
+  data.push_back(is_decorated ? decorated_flag : 0);
+  write_u32(data, runs.size());
+  data.insert(data.end(), compressed_runs.begin(), compressed_runs.end());
+  return data;
+}
+
+bool decode_chunk_blocks(ByteSpan                                     data,
+                         int                                          width,
+                         int                                          height,
+                         const std::function<void(const BlockRun &)> &function)
+{
+  Reader reader{data};
+
+  const auto version = reader.read_u8();
+  if (version != run_format_version && version != lz_format_version &&
+      version != format_version)
+  {
+    throw std::runtime_error("Unknown chunk data version " +
+                             std::to_string(version));
+  }
+
+  const int stored_width  = reader.read_u16();
+  const int stored_height = reader.read_u16();
+  if (stored_width != width || stored_height != height)
+  {
+    throw std::runtime_error(
+        "Chunk data is for " + std::to_string(stored_width) + "x" +
+        std::to_string(stored_height) + " chunks, expected " +
+        std::to_string(width) + "x" + std::to_string(height));
+  }
+
+  const auto flags =
+      version == format_version ? reader.read_u8() : decorated_flag;
+
+  auto runs = reader.remaining();
+  if (version != run_format_version)
+  {
+    // A column has at most height runs of three bytes
+    const auto runs_size     = reader.read_u32();
+    const auto max_runs_size = std::size_t{3} * width * width * height;
+    if (runs_size > max_runs_size)
+    {
+      throw std::runtime_error("Chunk data is corrupt");
+    }
+
+    // Copies refer back to earlier runs, so the runs are decompressed once
+    // instead of in both passes. A chunk has a few KiB of runs.
+    thread_local std::vector<std::uint8_t> decompressed_runs;
+    lz_decompress(reader.remaining(), runs_size, decompressed_runs);
+    runs = decompressed_runs;
+  }
+
+  // Reads the runs once without calling the function to check the data, so
+  // nothing is changed if it is corrupt
+  read_runs(runs, width, height, nullptr);
+  read_runs(runs, width, height, &function);
+  return (flags & decorated_flag) != 0;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "block.hpp"
+#include "byte_span.hpp"
+#include "chunk.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Blocks of equal type next to each other in a column
+struct BlockRun
+{
+  int         x;
+  int         y;
+  int         z;
+  int         length;
+  Block::Type type;
+};
+
+// Serializes the blocks of a chunk column by column as runs of equal blocks.
+// Columns are mostly a few long runs of dirt, water and air, so this is a
+// lot smaller than one byte per block. Neighbouring columns tend to have the
+// same runs, an LZ pass over the runs removes most of the rest. Whether the
+// trees of the chunk were placed is stored with the blocks.
+std::vector<std::uint8_t> encode_chunk_blocks(const ChunkBlockStorage &blocks,
+                                              bool is_decorated);
+
+// Calls the function for every run of blocks in the data and returns whether
+// the chunk was decorated. The whole data is checked first, it throws
+// std::runtime_error before the first call if the data is corrupt or was
+// written for chunks of another size. Also reads data written before the LZ
+// pass and the decoration flag were added, these chunks had their trees.
+// Runs without the LZ pass are read in place, compressed runs are first
+// decompressed into a buffer that is reused per thread.
+bool decode_chunk_blocks(ByteSpan                                     data,
+                         int                                          width,
+                         int                                          height,
+                         const std::function<void(const BlockRun &)> &function);
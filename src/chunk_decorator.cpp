@@ -0,0 +1,210 @@
+#include "chunk_decorator.hpp"
+#include "application.hpp"
+#include "chunk.hpp"
+#include "hash_random.hpp"
+#include "simplex_noise.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+// Writes the maximum of every window of 2 * radius + 1 values in count
+// values that are stride apart, count - 2 * radius maxima in total. Takes
+// linear time no matter the radius (van Herk/Gil-Werman): the values are
+// split into blocks of the window size, and every window is the end of one
+// block and the start of the next.
+void sliding_window_max(const float *values,
+                        std::size_t  stride,
+                        int          count,
+                        int          radius,
+                        float       *maxima,
+                        std::size_t  maxima_stride)
+{
+  const auto window = 2 * radius + 1;
+  assert(count >= window);
+
+  // Maximum from the start of the block to the value and from the value to
+  // the end of the block
+  thread_local std::vector<float> prefix;
+  thread_local std::vector<float> suffix;
+  prefix.resize(count);
+  suffix.resize(count);
+
+  for (int i = 0; i < count; ++i)
+  {
+    const auto value = values[i * stride];
+    prefix[i] = i % window == 0 ? value : std::max(prefix[i - 1], value);
+  }
+  for (int i = count - 1; i >= 0; --i)
+  {
+    const auto value = values[i * stride];
+    suffix[i] = i == count - 1 || (i + 1) % window == 0
+                    ? value
+                    : std::max(suffix[i + 1], value);
+  }
+
+  for (int i = 0; i + window <= count; ++i)
+  {
+    maxima[i * maxima_stride] = std::max(suffix[i], prefix[i + window - 1]);
+  }
+}
+} // namespace
+
+ChunkDecorator::ChunkDecorator()
+{
+  const auto settings = Application::instance()->settings();
+
+  tree_density_      = settings->chunk.tree_density;
+  min_tree_height_   = settings->chunk.min_tree_height;
+  max_tree_height_   = settings->chunk.max_tree_height;
+  min_leaves_radius_ = settings->chunk.min_leaves_radius;
+  max_leaves_radius_ = settings->chunk.max_leaves_radius;
+  leave_density_     = settings->chunk.leaves_density;
+  seed_              = settings->world.seed;
+}
+
+std::vector<DecorationBlock>
+ChunkDecorator::decorate(const glm::ivec3     &chunk_position,
+                         const ChunkHeightmap &heightmap) const
+{
+  const auto width      = Chunk::width();
+  const auto height     = Chunk::height();
+  const auto place_tree = tree_sites(chunk_position);
+
+  // Trees may reach into the neighbours, but not any further
+  const glm::ivec3 origin{chunk_position.x * width,
+                          0,
+                          chunk_position.z * width};
+  const auto       is_in_reach = [width](int x, int z)
+  { return -width <= x && x < 2 * width && -width <= z && z < 2 * width; };
+
+  std::vector<DecorationBlock> blocks;
+  for (int x = 0; x < width; ++x)
+  {
+    for (int z = 0; z < width; ++z)
+    {
+      if (!place_tree[x * width + z] ||
+          heightmap.biome(x, z) != Biome::Grassland)
+      {
+        continue;
+      }
+
+      // Every tree draws from its own generator, so it looks the same no
+      // matter which trees were placed before
+      const auto y = heightmap.height(x, z);
+      HashRandom rng{seed_, origin.x + x, origin.z + z};
+
+      const auto tree_height =
+          rng.uniform_int(min_tree_height_, max_tree_height_);
+      for (int i = y + 1; i < y + tree_height && i < height; ++i)
+      {
+        blocks.push_back(
+            {origin + glm::ivec3{x, i, z}, Block::Type::Oak, true});
+      }
+
+      const auto leave_radius =
+          rng.uniform_int(min_leaves_radius_, max_leaves_radius_);
+      for (int leave_x = -leave_radius; leave_x < leave_radius + 1; ++leave_x)
+      {
+        for (int leave_z = -leave_radius; leave_z < leave_radius + 1;
+             ++leave_z)
+        {
+          for (int leave_y = -leave_radius; leave_y < leave_radius + 1;
+               ++leave_y)
+          {
+            // Drawn before the bounds are checked, so clipped leaves do not
+            // change the others
+            if (rng.uniform_int(0, leave_density_) != leave_density_)
+            {
+              continue;
+            }
+
+            const int real_leave_x{x + leave_x};
+            const int real_leave_y{tree_height + y + leave_y};
+            const int real_leave_z{z + leave_z};
+            if (!is_in_reach(real_leave_x, real_leave_z) ||
+                real_leave_y < 0 || real_leave_y >= height)
+            {
+              continue;
+            }
+
+            blocks.push_back(
+                {origin + glm::ivec3{real_leave_x, real_leave_y, real_leave_z},
+                 Block::Type::OakLeaves,
+                 false});
+          }
+        }
+      }
+    }
+  }
+  return blocks;
+}
+
+std::vector<bool>
+ChunkDecorator::tree_sites(const glm::ivec3 &chunk_position) const
+{
+  const auto width = Chunk::width();
+
+  // Blue noise of the chunk and tree_density_ columns around it, so a
+  // column gets the same tree no matter which chunk looks at it
+  const auto         radius       = std::max(tree_density_, 0);
+  const auto         padded_width = width + 2 * radius;
+  const auto         padded_count =
+      static_cast<std::size_t>(padded_width) * padded_width;
+  std::vector<float> noise_x(padded_count);
+  std::vector<float> noise_z(padded_count);
+  std::vector<float> blue_noise(padded_count);
+  for (int x = 0; x < padded_width; ++x)
+  {
+    for (int z = 0; z < padded_width; ++z)
+    {
+      const auto world_x = chunk_position.x * width + x - radius;
+      const auto world_z = chunk_position.z * width + z - radius;
+
+      noise_x[x * padded_width + z] = 50.0f * (world_x + 0.5f);
+      noise_z[x * padded_width + z] = 50.0f * (world_z + 0.5f);
+    }
+  }
+  simplex_noise_2d(noise_x.data(),
+                   noise_z.data(),
+                   blue_noise.data(),
+                   padded_count);
+
+  // The maximum of the window around a column is separable, so it is taken
+  // along z for every row first and then along x
+  std::vector<float> row_maxima(static_cast<std::size_t>(padded_width) *
+                                width);
+  std::vector<float> window_maxima(static_cast<std::size_t>(width) * width);
+  for (int x = 0; x < padded_width; ++x)
+  {
+    sliding_window_max(&blue_noise[x * padded_width],
+                       1,
+                       padded_width,
+                       radius,
+                       &row_maxima[x * width],
+                       1);
+  }
+  for (int z = 0; z < width; ++z)
+  {
+    sliding_window_max(&row_maxima[z],
+                       width,
+                       padded_width,
+                       radius,
+                       &window_maxima[z],
+                       width);
+  }
+
+  // Trees grow where the blue noise is highest within tree_density_ columns
+  std::vector<bool> sites(static_cast<std::size_t>(width) * width);
+  for (int x = 0; x < width; ++x)
+  {
+    for (int z = 0; z < width; ++z)
+    {
+      const auto noise = blue_noise[(x + radius) * padded_width + z + radius];
+      sites[x * width + z] =
+          noise >= 0.0f && noise == window_maxima[x * width + z];
+    }
+  }
+  return sites;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "block.hpp"
+#include "heightmap.hpp"
+#include "math.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// A block of a decoration in world coordinates
+struct DecorationBlock
+{
+  glm::ivec3  position;
+  Block::Type type;
+  // Replaces any block, otherwise the block only grows into air
+  bool is_replacing;
+};
+
+// Plants the trees of a chunk once the terrain is generated, using the tree
+// settings in [Chunk]. Trees may grow into the neighbouring chunks, so the
+// blocks are placed by the caller once the terrain of all eight neighbours
+// is there. Can be used from several threads.
+class ChunkDecorator
+{
+public:
+  ChunkDecorator();
+
+  // Blocks of the trees that grow from the columns of the chunk. Only looks
+  // at the heightmap, never at blocks, so the result does not depend on the
+  // neighbours or on the order chunks are decorated in. Blocks outside of
+  // the chunk and its eight neighbours are left out.
+  std::vector<DecorationBlock> decorate(const glm::ivec3     &chunk_position,
+                                        const ChunkHeightmap &heightmap) const;
+
+private:
+  int min_tree_height_;
+  int max_tree_height_;
+
+  int min_leaves_radius_;
+  int max_leaves_radius_;
+
+  int tree_density_;
+  int leave_density_;
+
+  // [World] seed, varies the trees
+  std::uint32_t seed_ = 0;
+
+  // Whether the blue noise of the column is the highest within
+  // tree_density_ columns, for every column of the chunk
+  std::vector<bool> tree_sites(const glm::ivec3 &chunk_position) const;
+};
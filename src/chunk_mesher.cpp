@@ -0,0 +1,1026 @@
+#include "chunk_mesher.hpp"
+#include "application.hpp"
+#include "log/log.hpp"
+#include "world.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif // _MSC_VER
+
+namespace
+{
+struct FaceCorner
+{
+  glm::ivec3 offset;
+  glm::ivec2 tex_coord;
+};
+
+struct Face
+{
+  Block::Side side;
+  glm::ivec3  normal;
+
+  // Axes along which the texture coordinates u and v run
+  int u_axis;
+  int v_axis;
+
+  std::array<FaceCorner, 4> corners;
+};
+
+// Corners of a unit quad per side. Quads that span several blocks scale the
+// offsets and texture coordinates by their size, so textures repeat once per
+// block.
+const std::array<Face, 6> faces{{
+    {Block::Side::Front,
+     glm::ivec3{0, 0, 1},
+     0,
+     1,
+     {{{{0, 1, 1}, {0, 1}},
+       {{0, 0, 1}, {0, 0}},
+       {{1, 0, 1}, {1, 0}},
+       {{1, 1, 1}, {1, 1}}}}},
+    {Block::Side::Back,
+     glm::ivec3{0, 0, -1},
+     0,
+     1,
+     {{{{0, 1, 0}, {1, 1}},
+       {{1, 1, 0}, {0, 1}},
+       {{1, 0, 0}, {0, 0}},
+       {{0, 0, 0}, {1, 0}}}}},
+    {Block::Side::Top,
+     glm::ivec3{0, 1, 0},
+     0,
+     2,
+     {{{{0, 1, 1}, {0, 0}},
+       {{1, 1, 1}, {1, 0}},
+       {{1, 1, 0}, {1, 1}},
+       {{0, 1, 0}, {0, 1}}}}},
+    {Block::Side::Bottom,
+     glm::ivec3{0, -1, 0},
+     0,
+     2,
+     {{{{0, 0, 1}, {0, 1}},
+       {{0, 0, 0}, {0, 0}},
+       {{1, 0, 0}, {1, 0}},
+       {{1, 0, 1}, {1, 1}}}}},
+    {Block::Side::Left,
+     glm::ivec3{-1, 0, 0},
+     2,
+     1,
+     {{{{0, 0, 1}, {1, 0}},
+       {{0, 1, 1}, {1, 1}},
+       {{0, 1, 0}, {0, 1}},
+       {{0, 0, 0}, {0, 0}}}}},
+    {Block::Side::Right,
+     glm::ivec3{1, 0, 0},
+     2,
+     1,
+     {{{{1, 0, 1}, {0, 0}},
+       {{1, 0, 0}, {1, 0}},
+       {{1, 1, 0}, {1, 1}},
+       {{1, 1, 1}, {0, 1}}}}},
+}};
+
+// Bit layout of ChunkVertex, must match blinn_phong.vert and water.vert
+constexpr int vertex_x_bits     = 8;
+constexpr int vertex_y_bits     = 10;
+constexpr int vertex_z_bits     = 8;
+constexpr int vertex_face_bits  = 3;
+constexpr int vertex_uv_bits    = 10;
+constexpr int vertex_layer_bits = 12;
+
+// Corners on the far side of the chunk must still fit into a vertex
+static_assert(Chunk::width() < (1 << vertex_x_bits) &&
+                  Chunk::width() < (1 << vertex_z_bits) &&
+                  Chunk::height() < (1 << vertex_y_bits),
+              "Chunk is too big for packed vertices");
+
+// Order of the neighbours of a snapshot
+const std::array<glm::ivec3, 4> neighbour_offsets{
+    glm::ivec3{-1, 0, 0},
+    glm::ivec3{1, 0, 0},
+    glm::ivec3{0, 0, -1},
+    glm::ivec3{0, 0, 1},
+};
+
+std::array<const Chunk *, 4> neighbour_chunks(const Chunk &chunk,
+                                              const World &world)
+{
+  std::array<const Chunk *, 4> neighbours{};
+  for (std::size_t i = 0; i < neighbours.size(); ++i)
+  {
+    neighbours[i] =
+        world.generated_chunk(chunk.position() + neighbour_offsets[i]);
+  }
+  return neighbours;
+}
+
+// Distance from a block to its neighbour through the face in the snapshot
+std::array<std::ptrdiff_t, 6> face_offsets(const ChunkSnapshot &snapshot)
+{
+  std::array<std::ptrdiff_t, 6> offsets{};
+  for (std::size_t i = 0; i < faces.size(); ++i)
+  {
+    const auto &normal = faces[i].normal;
+    offsets[i] = normal.x * snapshot.stride(0) + normal.y * snapshot.stride(1) +
+                 normal.z * snapshot.stride(2);
+  }
+  return offsets;
+}
+
+int count_trailing_zeros(std::uint64_t value)
+{
+  assert(value != 0);
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward64(&index, value);
+  return static_cast<int>(index);
+#else  // _MSC_VER
+  return __builtin_ctzll(value);
+#endif // _MSC_VER
+}
+
+// Merges the set bits of the rows of a plane into rectangles, first along
+// the bits and then along the rows, like the greedy mesher does with its
+// mask. Calls emit(bit, row, width, height) for every rectangle and clears
+// the rows.
+template <typename Function>
+void merge_plane(std::uint64_t *rows,
+                 int            row_count,
+                 bool           can_grow_rows,
+                 Function     &&emit)
+{
+  for (int v = 0; v < row_count; ++v)
+  {
+    while (rows[v] != 0)
+    {
+      const auto u          = count_trailing_zeros(rows[v]);
+      const auto quad_width = count_trailing_zeros(~(rows[v] >> u));
+      const auto run        = ((std::uint64_t{1} << quad_width) - 1) << u;
+
+      int quad_height = 1;
+      while (can_grow_rows && v + quad_height < row_count &&
+             (rows[v + quad_height] & run) == run)
+      {
+        rows[v + quad_height] &= ~run;
+        ++quad_height;
+      }
+      rows[v] &= ~run;
+
+      emit(u, v, quad_width, quad_height);
+    }
+  }
+}
+
+// Faces of block types with the same texture, the binary mesher merges
+// them like the greedy mesher does
+struct TextureGroup
+{
+  int  tex_index;
+  int  transparency;
+  bool is_water;
+  // Bit per block type
+  unsigned types;
+};
+
+// Scratch buffers of the meshers, one set per thread. They keep their
+// capacity between chunks, so meshing stops allocating once they grew to
+// the largest chunk seen.
+struct MeshArena
+{
+  std::vector<MeshQuad> quads;
+  // Only used when the mesher is verified
+  std::vector<MeshQuad> naive_quads;
+  std::vector<bool>     is_layer_skipped;
+  // Greedy mesher
+  std::vector<int> mask;
+  // Binary mesher, see generate_binary_quads()
+  std::array<std::vector<std::uint64_t>, Block::transparency_count> class_rows;
+  std::array<std::vector<std::uint64_t>, Block::type_count>         type_rows;
+  std::vector<std::uint64_t> visible_rows;
+  std::vector<std::uint64_t> planes;
+  std::vector<TextureGroup>  groups;
+};
+
+MeshArena &mesh_arena()
+{
+  thread_local MeshArena arena;
+  return arena;
+}
+
+constexpr std::size_t mesh_buffer_count =
+    11 + Block::transparency_count + Block::type_count;
+
+// Capacity of every buffer meshing writes to. A buffer whose capacity
+// changed allocated at least once in between.
+std::array<std::size_t, mesh_buffer_count>
+mesh_buffer_capacities(const MeshArena &arena, const ChunkMeshData &mesh_data)
+{
+  std::array<std::size_t, mesh_buffer_count> capacities{
+      arena.quads.capacity(),
+      arena.naive_quads.capacity(),
+      arena.is_layer_skipped.capacity(),
+      arena.mask.capacity(),
+      arena.visible_rows.capacity(),
+      arena.planes.capacity(),
+      arena.groups.capacity(),
+      mesh_data.vertices.capacity(),
+      mesh_data.indices.capacity(),
+      mesh_data.water_vertices.capacity(),
+      mesh_data.water_indices.capacity(),
+  };
+  auto i = mesh_buffer_count - Block::transparency_count - Block::type_count;
+  for (const auto &rows : arena.class_rows)
+  {
+    capacities[i++] = rows.capacity();
+  }
+  for (const auto &rows : arena.type_rows)
+  {
+    capacities[i++] = rows.capacity();
+  }
+  return capacities;
+}
+
+struct MeshLayer
+{
+  std::vector<ChunkVertex> &vertices;
+  std::vector<unsigned>    &indices;
+};
+
+ChunkVertex pack_vertex(const glm::ivec3 &position,
+                        int               face,
+                        bool              is_lowered,
+                        const glm::ivec2 &tex_coord,
+                        int               tex_index)
+{
+  assert(position.x >= 0 && position.x < (1 << vertex_x_bits));
+  assert(position.y >= 0 && position.y < (1 << vertex_y_bits));
+  assert(position.z >= 0 && position.z < (1 << vertex_z_bits));
+  assert(tex_coord.x >= 0 && tex_coord.x < (1 << vertex_uv_bits));
+  assert(tex_coord.y >= 0 && tex_coord.y < (1 << vertex_uv_bits));
+  assert(face >= 0 && face < (1 << vertex_face_bits));
+  assert(tex_index >= 0 && tex_index < (1 << vertex_layer_bits));
+
+  ChunkVertex vertex{};
+  vertex.position = static_cast<std::uint32_t>(position.x) |
+                    static_cast<std::uint32_t>(position.y) << vertex_x_bits |
+                    static_cast<std::uint32_t>(position.z)
+                        << (vertex_x_bits + vertex_y_bits) |
+                    static_cast<std::uint32_t>(face)
+                        << (vertex_x_bits + vertex_y_bits + vertex_z_bits) |
+                    static_cast<std::uint32_t>(is_lowered) << 31;
+  vertex.tex_coord = static_cast<std::uint32_t>(tex_coord.x) |
+                     static_cast<std::uint32_t>(tex_coord.y) << vertex_uv_bits |
+                     static_cast<std::uint32_t>(tex_index)
+                         << (2 * vertex_uv_bits);
+  return vertex;
+}
+
+void emit_quad(MeshLayer &layer, const MeshQuad &quad, bool is_water)
+{
+  const auto &face        = faces[quad.face];
+  const auto  first_index = static_cast<unsigned>(layer.vertices.size());
+
+  for (const auto &corner : face.corners)
+  {
+    const glm::ivec3 position{quad.position.x + corner.offset.x * quad.size.x,
+                              quad.position.y + corner.offset.y * quad.size.y,
+                              quad.position.z + corner.offset.z * quad.size.z};
+    const glm::ivec2 tex_coord{corner.tex_coord.x * quad.size[face.u_axis],
+                               corner.tex_coord.y * quad.size[face.v_axis]};
+    // The top of water sits a bit lower than a full block
+    const auto is_lowered = is_water && corner.offset.y == 1;
+    layer.vertices.push_back(pack_vertex(position,
+                                         quad.face,
+                                         is_lowered,
+                                         tex_coord,
+                                         quad.tex_index));
+  }
+
+  for (const auto i : {0u, 1u, 2u, 2u, 3u, 0u})
+  {
+    layer.indices.push_back(first_index + i);
+  }
+}
+
+// Expands quads into the unit faces they cover, so the output of different
+// meshers can be compared
+std::vector<std::array<int, 6>>
+quad_coverage(const std::vector<MeshQuad> &quads)
+{
+  std::vector<std::array<int, 6>> coverage;
+  for (const auto &quad : quads)
+  {
+    for (int x = 0; x < quad.size.x; ++x)
+    {
+      for (int y = 0; y < quad.size.y; ++y)
+      {
+        for (int z = 0; z < quad.size.z; ++z)
+        {
+          coverage.push_back({quad.face,
+                              quad.position.x + x,
+                              quad.position.y + y,
+                              quad.position.z + z,
+                              quad.tex_index,
+                              quad.is_water});
+        }
+      }
+    }
+  }
+  std::sort(coverage.begin(), coverage.end());
+  return coverage;
+}
+} // namespace
+
+void ChunkMeshData::clear()
+{
+  vertices.clear();
+  indices.clear();
+  water_vertices.clear();
+  water_indices.clear();
+  face_count       = 0;
+  quad_count       = 0;
+  allocation_count = 0;
+}
+
+std::size_t ChunkMeshData::memory_usage() const
+{
+  return (vertices.size() + water_vertices.size()) * sizeof(ChunkVertex) +
+         (indices.size() + water_indices.size()) * sizeof(unsigned);
+}
+
+ChunkSnapshot::ChunkSnapshot(const Chunk &chunk, const World &world)
+    : ChunkSnapshot{chunk, neighbour_chunks(chunk, world)}
+{
+}
+
+ChunkSnapshot::ChunkSnapshot(const Chunk                        &chunk,
+                             const std::array<const Chunk *, 4> &neighbours)
+    : position_{chunk.position()},
+      padded_width_{Chunk::width() + 2},
+      padded_height_{Chunk::height() + 2},
+      blocks_(static_cast<std::size_t>(padded_width_) * padded_width_ *
+                  padded_height_,
+              Block::Type::Air)
+{
+  assert(chunk.is_generated());
+
+  const auto width  = Chunk::width();
+  const auto height = Chunk::height();
+
+  std::vector<bool> is_section_empty(Chunk::section_count());
+  is_section_skipped_.resize(Chunk::section_count());
+  for (int section = 0; section < Chunk::section_count(); ++section)
+  {
+    is_section_empty[section] = chunk.is_section_empty(section);
+    is_section_skipped_[section] =
+        chunk.is_section_empty(section) ||
+        chunk.is_section_buried(neighbours, section);
+  }
+
+  // Compressed chunks are only decoded for the copy
+  std::unique_ptr<ChunkBlockStorage> decompressed_blocks;
+  if (chunk.is_compressed())
+  {
+    decompressed_blocks =
+        std::make_unique<ChunkBlockStorage>(chunk.decompressed_blocks());
+  }
+  const auto &blocks = decompressed_blocks ? *decompressed_blocks
+                                           : chunk.blocks();
+
+  // Empty sections stay air
+  for (int section = 0; section < Chunk::section_count(); ++section)
+  {
+    if (is_section_empty[section])
+    {
+      continue;
+    }
+
+    const auto section_begin = section * Chunk::section_height;
+    const auto section_end =
+        std::min(section_begin + Chunk::section_height, height);
+    for (int x = 0; x < width; ++x)
+    {
+      for (int z = 0; z < width; ++z)
+      {
+        auto i = index(glm::ivec3{x, section_begin, z});
+        for (int y = section_begin; y < section_end; ++y, ++i)
+        {
+          blocks_[i] = blocks.type(x, y, z);
+        }
+      }
+    }
+  }
+
+  // The block of the neighbour that touches this chunk
+  const std::array<int, 4> borders{width - 1, 0, width - 1, 0};
+  for (std::size_t i = 0; i < neighbours.size(); ++i)
+  {
+    // Compressed neighbours are far from the player, their border faces
+    // are kept
+    const auto neighbour = neighbours[i];
+    if (!neighbour || neighbour->is_compressed())
+    {
+      continue;
+    }
+
+    const auto &offset = neighbour_offsets[i];
+    const auto  border = borders[i];
+
+    // Position of the padding column next to the neighbour
+    const auto padding = offset.x + offset.z < 0 ? -1 : width;
+    for (int along = 0; along < width; ++along)
+    {
+      const auto x         = offset.x != 0 ? border : along;
+      const auto z         = offset.z != 0 ? border : along;
+      const auto padding_x = offset.x != 0 ? padding : along;
+      const auto padding_z = offset.z != 0 ? padding : along;
+
+      auto i = index(glm::ivec3{padding_x, 0, padding_z});
+      for (int y = 0; y < height; ++y, ++i)
+      {
+        blocks_[i] = neighbour->block_type(glm::ivec3{x, y, z});
+      }
+    }
+  }
+}
+
+glm::ivec3 ChunkSnapshot::position() const { return position_; }
+
+Block::Type ChunkSnapshot::block_type(const glm::ivec3 &position) const
+{
+  return block_type(index(position));
+}
+
+bool ChunkSnapshot::is_section_skipped(int section) const
+{
+  assert(0 <= section && section < Chunk::section_count());
+  return is_section_skipped_[section];
+}
+
+ChunkMesher::ChunkMesher()
+    : ChunkMesher{Application::instance()->settings()->chunk}
+{
+}
+
+ChunkMesher::ChunkMesher(const ChunkSettings &settings)
+{
+  mesher_             = settings.mesher;
+  is_mesher_verified_ = settings.is_mesher_verified;
+
+  // A row of blocks and the two blocks next to it must fit into 64 bits
+  if (mesher_ == ChunkSettings::Mesher::Binary && Chunk::width() > 62)
+  {
+    throw std::runtime_error("Chunk is too wide for the binary mesher");
+  }
+}
+
+void ChunkMesher::mesh(const ChunkSnapshot &snapshot,
+                       ChunkMeshData       &mesh_data) const
+{
+  auto      &arena             = mesh_arena();
+  const auto capacities_before = mesh_buffer_capacities(arena, mesh_data);
+
+  auto &quads = arena.quads;
+  quads.clear();
+  switch (mesher_)
+  {
+  case ChunkSettings::Mesher::Naive:
+    generate_naive_quads(snapshot, quads);
+    break;
+  case ChunkSettings::Mesher::Greedy:
+    generate_greedy_quads(snapshot, quads);
+    break;
+  case ChunkSettings::Mesher::Binary:
+    generate_binary_quads(snapshot, quads);
+    break;
+  }
+
+  if (is_mesher_verified_ && mesher_ != ChunkSettings::Mesher::Naive)
+  {
+    auto &naive_quads = arena.naive_quads;
+    naive_quads.clear();
+    generate_naive_quads(snapshot, naive_quads);
+    if (quad_coverage(quads) != quad_coverage(naive_quads))
+    {
+      const auto position = snapshot.position();
+      LOG_ERROR() << (mesher_ == ChunkSettings::Mesher::Greedy ? "Greedy"
+                                                               : "Binary")
+                  << " mesh of chunk " << position.x << ", " << position.z
+                  << " does not cover the same faces as the naive mesh";
+    }
+  }
+
+  // Every quad is 4 vertices and 6 indices, so the buffers grow at most
+  // once
+  const auto water_quad_count =
+      std::count_if(quads.begin(),
+                    quads.end(),
+                    [](const MeshQuad &quad) { return quad.is_water; });
+  const auto block_quad_count = quads.size() - water_quad_count;
+  mesh_data.clear();
+  mesh_data.vertices.reserve(4 * block_quad_count);
+  mesh_data.indices.reserve(6 * block_quad_count);
+  mesh_data.water_vertices.reserve(4 * water_quad_count);
+  mesh_data.water_indices.reserve(6 * water_quad_count);
+
+  MeshLayer block_layer{mesh_data.vertices, mesh_data.indices};
+  MeshLayer water_layer{mesh_data.water_vertices, mesh_data.water_indices};
+  for (const auto &quad : quads)
+  {
+    mesh_data.face_count += quad.size.x * quad.size.y * quad.size.z;
+    emit_quad(quad.is_water ? water_layer : block_layer, quad, quad.is_water);
+  }
+  mesh_data.quad_count = quads.size();
+
+  const auto capacities_after = mesh_buffer_capacities(arena, mesh_data);
+  for (std::size_t i = 0; i < mesh_buffer_count; ++i)
+  {
+    mesh_data.allocation_count += capacities_before[i] != capacities_after[i];
+  }
+}
+
+void ChunkMesher::generate_naive_quads(const ChunkSnapshot   &snapshot,
+                                       std::vector<MeshQuad> &quads)
+{
+  const auto offsets = face_offsets(snapshot);
+  for (int section = 0; section < Chunk::section_count(); ++section)
+  {
+    if (snapshot.is_section_skipped(section))
+    {
+      continue;
+    }
+
+    const auto section_begin = section * Chunk::section_height;
+    const auto section_end =
+        std::min(section_begin + Chunk::section_height, Chunk::height());
+    for (int x = 0; x < Chunk::width(); ++x)
+    {
+      for (int z = 0; z < Chunk::width(); ++z)
+      {
+        auto index = snapshot.index(glm::ivec3{x, section_begin, z});
+        for (int y = section_begin; y < section_end; ++y, ++index)
+        {
+          const auto  block_type = snapshot.block_type(index);
+          const auto &properties = Block::properties(block_type);
+          if (properties.mesh_layer == Block::MeshLayer::None)
+          {
+            continue;
+          }
+
+          for (std::size_t i = 0; i < faces.size(); ++i)
+          {
+            const auto side = static_cast<int>(faces[i].side);
+            if (Block::is_face_hidden(block_type,
+                                      snapshot.block_type(index + offsets[i])))
+            {
+              continue;
+            }
+
+            MeshQuad quad{};
+            quad.face      = i;
+            quad.position  = glm::ivec3{x, y, z};
+            quad.size      = glm::ivec3{1};
+            quad.tex_index = properties.texture_layers[side];
+            quad.is_water  = properties.mesh_layer == Block::MeshLayer::Water;
+            quads.push_back(quad);
+          }
+        }
+      }
+    }
+  }
+}
+
+void ChunkMesher::generate_greedy_quads(const ChunkSnapshot   &snapshot,
+                                        std::vector<MeshQuad> &quads)
+{
+  auto &arena            = mesh_arena();
+  auto &is_layer_skipped = arena.is_layer_skipped;
+  is_layer_skipped.resize(Chunk::height());
+  for (int section = 0; section < Chunk::section_count(); ++section)
+  {
+    const auto is_skipped    = snapshot.is_section_skipped(section);
+    const auto section_begin = section * Chunk::section_height;
+    const auto section_end =
+        std::min(section_begin + Chunk::section_height, Chunk::height());
+    for (int y = section_begin; y < section_end; ++y)
+    {
+      is_layer_skipped[y] = is_skipped;
+    }
+  }
+
+  // A mask cell holds the texture index + 1 of the visible face, 0 if there is
+  // none. Water gets its own bit, because it ends up in a different mesh.
+  // Faces of blocks with the same texture are merged.
+  constexpr int water_bit = 1 << 16;
+
+  const glm::ivec3 extent{Chunk::width(), Chunk::height(), Chunk::width()};
+  const auto       offsets = face_offsets(snapshot);
+  auto            &mask    = arena.mask;
+  for (std::size_t i = 0; i < faces.size(); ++i)
+  {
+    const auto &face        = faces[i];
+    const auto  u_axis      = face.u_axis;
+    const auto  v_axis      = face.v_axis;
+    const auto  normal_axis = 3 - u_axis - v_axis;
+    const auto  u_size      = extent[u_axis];
+    const auto  v_size      = extent[v_axis];
+    const auto  u_stride    = snapshot.stride(u_axis);
+
+    for (int n = 0; n < extent[normal_axis]; ++n)
+    {
+      if (normal_axis == 1 && is_layer_skipped[n])
+      {
+        continue;
+      }
+
+      // Collect the visible faces of this slice
+      mask.assign(u_size * v_size, 0);
+      for (int v = 0; v < v_size; ++v)
+      {
+        if (v_axis == 1 && is_layer_skipped[v])
+        {
+          continue;
+        }
+        glm::ivec3 row_position{};
+        row_position[normal_axis] = n;
+        row_position[v_axis]      = v;
+
+        auto index = snapshot.index(row_position);
+        for (int u = 0; u < u_size; ++u, index += u_stride)
+        {
+          const auto  block_type = snapshot.block_type(index);
+          const auto &properties = Block::properties(block_type);
+          if (properties.mesh_layer == Block::MeshLayer::None ||
+              Block::is_face_hidden(block_type,
+                                    snapshot.block_type(index + offsets[i])))
+          {
+            continue;
+          }
+
+          mask[v * u_size + u] =
+              (properties.texture_layers[static_cast<int>(face.side)] + 1) |
+              (properties.mesh_layer == Block::MeshLayer::Water ? water_bit
+                                                                : 0);
+        }
+      }
+
+      // Merge equal faces into rectangles, first along u then along v
+      for (int v = 0; v < v_size; ++v)
+      {
+        for (int u = 0; u < u_size;)
+        {
+          const auto key = mask[v * u_size + u];
+          if (key == 0)
+          {
+            ++u;
+            continue;
+          }
+
+          int quad_width = 1;
+          while (u + quad_width < u_size &&
+                 mask[v * u_size + u + quad_width] == key)
+          {
+            ++quad_width;
+          }
+
+          // Water is lower than a full block, so stacking its side faces
+          // would close the gaps between them
+          const auto can_grow_v = !(key & water_bit) || v_axis != 1;
+
+          int quad_height = 1;
+          while (can_grow_v && v + quad_height < v_size)
+          {
+            const auto row = mask.begin() + (v + quad_height) * u_size + u;
+            if (!std::all_of(row,
+                             row + quad_width,
+                             [key](int cell) { return cell == key; }))
+            {
+              break;
+            }
+            ++quad_height;
+          }
+
+          for (int dv = 0; dv < quad_height; ++dv)
+          {
+            const auto row = mask.begin() + (v + dv) * u_size + u;
+            std::fill(row, row + quad_width, 0);
+          }
+
+          MeshQuad quad{};
+          quad.face                  = i;
+          quad.position[normal_axis] = n;
+          quad.position[u_axis]      = u;
+          quad.position[v_axis]      = v;
+          quad.size[normal_axis]     = 1;
+          quad.size[u_axis]          = quad_width;
+          quad.size[v_axis]          = quad_height;
+          quad.tex_index             = (key & ~water_bit) - 1;
+          quad.is_water              = key & water_bit;
+          quads.push_back(quad);
+
+          u += quad_width;
+        }
+      }
+    }
+  }
+}
+
+void ChunkMesher::generate_binary_quads(const ChunkSnapshot   &snapshot,
+                                        std::vector<MeshQuad> &quads)
+{
+  const auto width = Chunk::width();
+  assert(width <= 62);
+
+  auto &arena = mesh_arena();
+
+  // Only layers of sections that are not skipped can have faces
+  auto &is_layer_skipped = arena.is_layer_skipped;
+  is_layer_skipped.resize(Chunk::height());
+  int y_begin = Chunk::height();
+  int y_end   = 0;
+  for (int section = 0; section < Chunk::section_count(); ++section)
+  {
+    const auto is_skipped    = snapshot.is_section_skipped(section);
+    const auto section_begin = section * Chunk::section_height;
+    const auto section_end =
+        std::min(section_begin + Chunk::section_height, Chunk::height());
+    for (int y = section_begin; y < section_end; ++y)
+    {
+      is_layer_skipped[y] = is_skipped;
+    }
+    if (!is_skipped)
+    {
+      y_begin = std::min(y_begin, section_begin);
+      y_end   = std::max(y_end, section_end);
+    }
+  }
+  if (y_begin >= y_end)
+  {
+    return;
+  }
+  const auto layers        = y_end - y_begin;
+  const auto padded_layers = layers + 2;
+
+  constexpr auto type_count  = Block::type_count;
+  constexpr auto class_count = Block::transparency_count;
+  constexpr auto opaque      = static_cast<int>(Block::Transparency::Opaque);
+  constexpr auto invisible   = static_cast<int>(Block::Transparency::Invisible);
+
+  const auto transparency = [](Block::Type type)
+  { return static_cast<int>(Block::properties(type).transparency); };
+  // Bit per block type of every transparency class
+  constexpr auto class_types = []
+  {
+    std::array<unsigned, class_count> types{};
+    for (int type = 0; type < type_count; ++type)
+    {
+      const auto transparency = block_properties[type].transparency;
+      types[static_cast<int>(transparency)] |= 1u << type;
+    }
+    return types;
+  }();
+
+  // Rows of blocks along z as bits per transparency class, for every x and
+  // layer including the padding around them. Bit z + 1 is the block at z.
+  auto &class_rows = arena.class_rows;
+  // Rows of the chunk itself per block type, bit z is the block at z. Rows
+  // of skipped sections are cleared, so they get no faces.
+  auto &type_rows = arena.type_rows;
+
+  const auto padded_row = [padded_layers, y_begin](int x, int y)
+  { return (x + 1) * padded_layers + y - y_begin + 1; };
+  const auto row = [layers, y_begin](int x, int y)
+  { return x * layers + y - y_begin; };
+
+  for (auto &rows : class_rows)
+  {
+    rows.assign(static_cast<std::size_t>(width + 2) * padded_layers, 0);
+  }
+  for (auto &rows : type_rows)
+  {
+    rows.assign(static_cast<std::size_t>(width) * layers, 0);
+  }
+
+  // Blocks of the padding, the chunk itself is added from the type rows
+  for (int x = -1; x <= width; ++x)
+  {
+    for (int z = -1; z <= width; ++z)
+    {
+      const auto is_inside = 0 <= x && x < width && 0 <= z && z < width;
+      const auto bit       = std::uint64_t{1} << (z + 1);
+      for (int y = y_begin - 1; y <= y_end;
+           y += is_inside ? layers + 1 : 1)
+      {
+        const auto type = snapshot.block_type(glm::ivec3{x, y, z});
+        class_rows[transparency(type)][padded_row(x, y)] |= bit;
+      }
+    }
+  }
+
+  unsigned present_types = 0;
+  for (int x = 0; x < width; ++x)
+  {
+    for (int z = 0; z < width; ++z)
+    {
+      const auto bit       = std::uint64_t{1} << z;
+      auto       index     = snapshot.index(glm::ivec3{x, y_begin, z});
+      auto       row_index = row(x, y_begin);
+      for (int y = y_begin; y < y_end; ++y, ++index, ++row_index)
+      {
+        const auto type = static_cast<int>(snapshot.block_type(index));
+        type_rows[type][row_index] |= bit;
+        present_types |= 1u << type;
+      }
+    }
+  }
+
+  for (int x = 0; x < width; ++x)
+  {
+    for (int y = y_begin; y < y_end; ++y)
+    {
+      // Invisible blocks hide nothing but other invisible blocks, which
+      // have no faces
+      for (int c = 0; c < class_count; ++c)
+      {
+        if (c == invisible)
+        {
+          continue;
+        }
+        std::uint64_t blocks = 0;
+        for (auto types = class_types[c]; types != 0; types &= types - 1)
+        {
+          blocks |= type_rows[count_trailing_zeros(types)][row(x, y)];
+        }
+        class_rows[c][padded_row(x, y)] |= blocks << 1;
+      }
+    }
+  }
+
+  for (int y = y_begin; y < y_end; ++y)
+  {
+    if (!is_layer_skipped[y])
+    {
+      continue;
+    }
+    for (int type = 0; type < type_count; ++type)
+    {
+      for (int x = 0; x < width; ++x)
+      {
+        type_rows[type][row(x, y)] = 0;
+      }
+    }
+  }
+
+  auto &groups       = arena.groups;
+  auto &visible_rows = arena.visible_rows;
+  auto &planes       = arena.planes;
+  for (std::size_t i = 0; i < faces.size(); ++i)
+  {
+    const auto &face   = faces[i];
+    const auto &normal = face.normal;
+
+    groups.clear();
+    for (int type = 0; type < type_count; ++type)
+    {
+      const auto  block_type = static_cast<Block::Type>(type);
+      const auto &properties = Block::properties(block_type);
+      if (!(present_types & (1u << type)) ||
+          properties.mesh_layer == Block::MeshLayer::None)
+      {
+        continue;
+      }
+
+      const auto tex_index  = Block::texture_layer(block_type, face.side);
+      const auto type_class = transparency(block_type);
+      const auto is_water   = properties.mesh_layer == Block::MeshLayer::Water;
+      const auto group      = std::find_if(
+          groups.begin(),
+          groups.end(),
+          [tex_index, type_class, is_water](const TextureGroup &g)
+          {
+            return g.tex_index == tex_index &&
+                   g.transparency == type_class && g.is_water == is_water;
+          });
+      if (group == groups.end())
+      {
+        groups.push_back({tex_index, type_class, is_water, 1u << type});
+      }
+      else
+      {
+        group->types |= 1u << type;
+      }
+    }
+
+    for (const auto &group : groups)
+    {
+      // Opaque blocks hide all faces, the others only hide the faces of
+      // their own transparency class, like water next to water.
+      // Shifting the neighbouring row moves the neighbour along z to the bit
+      // of the block.
+      const auto shift = 1 + normal.z;
+      visible_rows.resize(static_cast<std::size_t>(width) * layers);
+      for (int x = 0; x < width; ++x)
+      {
+        for (int y = y_begin; y < y_end; ++y)
+        {
+          std::uint64_t blocks = 0;
+          for (auto types = group.types; types != 0; types &= types - 1)
+          {
+            blocks |= type_rows[count_trailing_zeros(types)][row(x, y)];
+          }
+          if (blocks == 0)
+          {
+            visible_rows[row(x, y)] = 0;
+            continue;
+          }
+
+          const auto neighbour = padded_row(x + normal.x, y + normal.y);
+          auto       hiding    = class_rows[opaque][neighbour];
+          if (group.transparency != opaque)
+          {
+            hiding |= class_rows[group.transparency][neighbour];
+          }
+          visible_rows[row(x, y)] = blocks & ~(hiding >> shift);
+        }
+      }
+
+      const auto emit = [&quads, &group, i](const glm::ivec3 &position,
+                                            const glm::ivec3 &size)
+      {
+        MeshQuad quad{};
+        quad.face      = i;
+        quad.position  = position;
+        quad.size      = size;
+        quad.tex_index = group.tex_index;
+        quad.is_water  = group.is_water;
+        quads.push_back(quad);
+      };
+
+      // Water is lower than a full block, so stacking its side faces would
+      // close the gaps between them
+      const auto can_grow_y = !group.is_water;
+      if (normal.x != 0)
+      {
+        // Rows along z for every layer of the slice
+        for (int x = 0; x < width; ++x)
+        {
+          merge_plane(&visible_rows[row(x, y_begin)],
+                      layers,
+                      can_grow_y,
+                      [&emit, x, y_begin](int z, int v, int size_z, int size_y)
+                      { emit({x, y_begin + v, z}, {1, size_y, size_z}); });
+        }
+      }
+      else if (normal.y != 0)
+      {
+        // Rows along z for every x of the slice
+        planes.resize(width);
+        for (int y = y_begin; y < y_end; ++y)
+        {
+          for (int x = 0; x < width; ++x)
+          {
+            planes[x] = visible_rows[row(x, y)];
+          }
+          merge_plane(planes.data(),
+                      width,
+                      true,
+                      [&emit, y](int z, int x, int size_z, int size_x)
+                      { emit({x, y, z}, {size_x, 1, size_z}); });
+        }
+      }
+      else
+      {
+        // Slices along z need rows along x, the bits are moved over one by
+        // one
+        planes.assign(static_cast<std::size_t>(width) * layers, 0);
+        for (int x = 0; x < width; ++x)
+        {
+          for (int y = y_begin; y < y_end; ++y)
+          {
+            for (auto bits = visible_rows[row(x, y)]; bits != 0;
+                 bits &= bits - 1)
+            {
+              const auto z = count_trailing_zeros(bits);
+              planes[row(z, y)] |= std::uint64_t{1} << x;
+            }
+          }
+        }
+        for (int z = 0; z < width; ++z)
+        {
+          merge_plane(&planes[row(z, y_begin)],
+                      layers,
+                      can_grow_y,
+                      [&emit, z, y_begin](int x, int v, int size_x, int size_y)
+                      { emit({x, y_begin + v, z}, {size_x, size_y, 1}); });
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "block.hpp"
+#include "chunk.hpp"
+#include "math.hpp"
+#include "settings.hpp"
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+class World;
+
+// A rectangle of equal block faces that becomes one quad in the mesh
+struct MeshQuad
+{
+  // Index into the face table of the mesher
+  int        face;
+  glm::ivec3 position;
+  // Extent in blocks, 1 along the normal of the face
+  glm::ivec3 size;
+  int        tex_index;
+  bool       is_water;
+};
+
+// Mesh of a chunk on the CPU side, ready to be uploaded to the GPU
+struct ChunkMeshData
+{
+  std::vector<ChunkVertex> vertices;
+  std::vector<unsigned>    indices;
+  std::vector<ChunkVertex> water_vertices;
+  std::vector<unsigned>    water_indices;
+
+  // Block faces in the mesh and the number of quads that were emitted for
+  // them. These only differ with greedy meshing.
+  int face_count = 0;
+  int quad_count = 0;
+  // Buffers that had to grow while meshing, each of them allocated at
+  // least once. 0 once the buffers fit the largest chunk seen.
+  int allocation_count = 0;
+
+  // Empties the mesh, but keeps the capacity of the buffers
+  void        clear();
+  std::size_t memory_usage() const;
+};
+
+// Read-only copy of a chunk padded by one block on every side. The padding
+// holds the blocks of the four neighbours that touch the chunk, so the
+// mesher can look at the neighbour of any block without bounds checks or
+// calls into the world. This is all the mesher needs, so meshing can run on
+// any thread.
+class ChunkSnapshot
+{
+public:
+  ChunkSnapshot(const Chunk &chunk, const World &world);
+  // The neighbours are the chunks at -x, +x, -z and +z, null if they are
+  // not generated. Compressed neighbours only count for buried sections.
+  ChunkSnapshot(const Chunk                        &chunk,
+                const std::array<const Chunk *, 4> &neighbours);
+
+  glm::ivec3 position() const;
+
+  // Index of a block, every coordinate may be one block outside of the
+  // chunk. Blocks next to each other along an axis are stride(axis) apart.
+  [[nodiscard]] std::ptrdiff_t index(const glm::ivec3 &position) const;
+  [[nodiscard]] std::ptrdiff_t stride(int axis) const;
+
+  [[nodiscard]] Block::Type block_type(std::ptrdiff_t index) const;
+  // Positions one block outside of the chunk along x or z look into the
+  // neighbours. The rest of the padding is air.
+  Block::Type block_type(const glm::ivec3 &position) const;
+
+  // Empty and buried sections have no visible faces
+  [[nodiscard]] bool is_section_skipped(int section) const;
+
+private:
+  glm::ivec3 position_;
+
+  // Columns of padded_height_ blocks, x major like BlockStorage
+  int                      padded_width_;
+  int                      padded_height_;
+  std::vector<Block::Type> blocks_;
+
+  std::vector<bool> is_section_skipped_;
+};
+
+inline std::ptrdiff_t ChunkSnapshot::index(const glm::ivec3 &position) const
+{
+  assert(-1 <= position.x && position.x < padded_width_ - 1);
+  assert(-1 <= position.y && position.y < padded_height_ - 1);
+  assert(-1 <= position.z && position.z < padded_width_ - 1);
+
+  return (static_cast<std::ptrdiff_t>(position.x + 1) * padded_width_ +
+          position.z + 1) *
+             padded_height_ +
+         position.y + 1;
+}
+
+inline std::ptrdiff_t ChunkSnapshot::stride(int axis) const
+{
+  assert(0 <= axis && axis < 3);
+
+  if (axis == 0)
+  {
+    return static_cast<std::ptrdiff_t>(padded_width_) * padded_height_;
+  }
+  return axis == 1 ? 1 : padded_height_;
+}
+
+inline Block::Type ChunkSnapshot::block_type(std::ptrdiff_t index) const
+{
+  assert(0 <= index && index < static_cast<std::ptrdiff_t>(blocks_.size()));
+  return blocks_[index];
+}
+
+class ChunkMesher
+{
+public:
+  // Uses the [Chunk] settings of the application
+  ChunkMesher();
+  explicit ChunkMesher(const ChunkSettings &settings);
+
+  // Can be called from any thread. Reuses the buffers of mesh_data and
+  // scratch buffers of the calling thread, so meshing does not allocate once
+  // they are large enough.
+  void mesh(const ChunkSnapshot &snapshot, ChunkMeshData &mesh_data) const;
+
+  static void generate_naive_quads(const ChunkSnapshot   &snapshot,
+                                   std::vector<MeshQuad> &quads);
+  static void generate_greedy_quads(const ChunkSnapshot   &snapshot,
+                                    std::vector<MeshQuad> &quads);
+  // Covers the same faces as generate_greedy_quads(), but culls and merges
+  // them on bit masks of the blocks. Top and bottom faces are merged along
+  // z first instead of x. Chunks must be at most 62 blocks wide.
+  static void generate_binary_quads(const ChunkSnapshot   &snapshot,
+                                    std::vector<MeshQuad> &quads);
+
+private:
+  ChunkSettings::Mesher mesher_             = ChunkSettings::Mesher::Naive;
+  bool                  is_mesher_verified_ = false;
+};
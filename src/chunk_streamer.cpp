@@ -0,0 +1,781 @@
+#include "chunk_streamer.hpp"
+#include "application.hpp"
+#include "chunk.hpp"
+#include "log/log.hpp"
+#include "region_storage.hpp"
+#include "time.hpp"
+#include "world.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace
+{
+const std::array<glm::ivec3, 4> neighbour_offsets{
+    glm::ivec3{-1, 0, 0},
+    glm::ivec3{0, 0, -1},
+    glm::ivec3{1, 0, 0},
+    glm::ivec3{0, 0, 1},
+};
+
+// Trees reach into these chunks, the diagonal ones included
+const std::array<glm::ivec3, 8> decoration_offsets{
+    glm::ivec3{-1, 0, -1},
+    glm::ivec3{-1, 0, 0},
+    glm::ivec3{-1, 0, 1},
+    glm::ivec3{0, 0, -1},
+    glm::ivec3{0, 0, 1},
+    glm::ivec3{1, 0, -1},
+    glm::ivec3{1, 0, 0},
+    glm::ivec3{1, 0, 1},
+};
+
+// Returns false if the chunk was never saved or its data is corrupt
+bool load_chunk_data(Chunk &c, ByteSpan data)
+{
+  if (data.empty())
+  {
+    return false;
+  }
+
+  try
+  {
+    c.load(data);
+  }
+  catch (const std::runtime_error &error)
+  {
+    LOG_ERROR() << "Generating chunk " << c.position().x << ", "
+                << c.position().z << " again: " << error.what();
+    return false;
+  }
+  return true;
+}
+} // namespace
+
+ChunkStreamer::ChunkStreamer(World &world) : world_{world}
+{
+  const auto settings = Application::instance()->settings();
+
+  chunks_around_player_ = settings->world.chunks_around_player;
+  worker_pool_ = std::make_unique<ThreadPool>(settings->world.worker_count);
+  apply_settings(settings->world);
+  LOG_INFO() << "Streaming chunks on " << worker_pool_->worker_count()
+             << " worker threads with up to " << max_jobs_in_flight_
+             << " jobs in flight";
+}
+
+ChunkStreamer::~ChunkStreamer()
+{
+  // Jobs reference the chunks, so wait for the workers first
+  worker_pool_.reset();
+}
+
+int ChunkStreamer::update(const glm::ivec3 &player_chunk_position,
+                          const glm::vec3  &view_direction)
+{
+  prefetch_regions(player_chunk_position);
+  player_chunk_position_ = player_chunk_position;
+
+  // Only the horizontal direction matters for chunk columns
+  view_direction_ = glm::vec2{view_direction.x, view_direction.z};
+  if (glm::length(view_direction_) > 0.0f)
+  {
+    view_direction_ = glm::normalize(view_direction_);
+  }
+
+  collect_finished_jobs();
+
+  // The chunk the player is in is needed right away, so the player does not
+  // fall through the world
+  const glm::ivec3 pos{player_chunk_position.x, 0, player_chunk_position.z};
+  auto &c = world_.load_chunk(pos);
+  if (!c.is_generated() && !c.is_generating())
+  {
+    if (!load_chunk_data(c, world_.region_storage().load_now(pos)))
+    {
+      c.generate(pos, world_);
+    }
+    on_chunk_generated(pos);
+  }
+
+  remesh_dirty_chunks();
+
+  dispatch_jobs();
+
+  return upload_meshes();
+}
+
+void ChunkStreamer::apply_settings(const WorldSettings &settings)
+{
+  max_jobs_in_flight_ = settings.max_jobs_in_flight;
+  if (max_jobs_in_flight_ <= 0)
+  {
+    max_jobs_in_flight_ = 2 * worker_pool_->worker_count();
+  }
+  upload_budget_ms_  = settings.upload_budget_ms;
+  upload_budget_kib_ = settings.upload_budget_kib;
+  view_weight_       = settings.view_weight;
+}
+
+void ChunkStreamer::request_meshing(const glm::ivec3 &chunk_position)
+{
+  ++remesh_counters_.requested;
+  if (!meshing_queue_set_.insert(chunk_position).second)
+  {
+    ++remesh_counters_.avoided;
+    return;
+  }
+  meshing_queue_.push_back(chunk_position);
+}
+
+void ChunkStreamer::mark_dirty(const glm::ivec3 &chunk_position)
+{
+  ++remesh_counters_.requested;
+  if (!dirty_chunks_set_.insert(chunk_position).second)
+  {
+    ++remesh_counters_.avoided;
+    return;
+  }
+  dirty_chunks_.push_back(chunk_position);
+}
+
+ChunkStreamer::QueueDepths ChunkStreamer::queue_depths() const
+{
+  QueueDepths depths{};
+  depths.generation = generation_candidates_.size();
+  depths.decoration = decoration_candidates_.size();
+  depths.meshing    = meshing_queue_.size();
+  depths.in_flight  = in_flight_count_;
+  depths.upload     = upload_queue_.size();
+  return depths;
+}
+
+ChunkStreamer::RemeshCounters ChunkStreamer::remesh_counters() const
+{
+  return remesh_counters_;
+}
+
+int ChunkStreamer::worker_count() const { return worker_pool_->worker_count(); }
+
+int ChunkStreamer::chunks_around_player() const
+{
+  return chunks_around_player_;
+}
+
+bool ChunkStreamer::is_streamed(const glm::ivec3 &chunk_position) const
+{
+  return std::abs(chunk_position.x - player_chunk_position_.x) <=
+             chunks_around_player_ &&
+         std::abs(chunk_position.z - player_chunk_position_.z) <=
+             chunks_around_player_;
+}
+
+float ChunkStreamer::priority(const glm::ivec3 &chunk_position) const
+{
+  const glm::vec2 offset{chunk_position.x - player_chunk_position_.x,
+                         chunk_position.z - player_chunk_position_.z};
+  const auto      distance = glm::length(offset);
+  if (distance == 0.0f)
+  {
+    return 0.0f;
+  }
+
+  // 1 straight ahead, 0 to the side and -1 behind the player
+  const auto alignment = glm::dot(offset / distance, view_direction_);
+  return distance * (1.0f + view_weight_ * (1.0f - alignment) * 0.5f);
+}
+
+void ChunkStreamer::prefetch_regions(const glm::ivec3 &player_chunk_position)
+{
+  const auto movement = player_chunk_position - player_chunk_position_;
+  if (movement.x == 0 && movement.z == 0)
+  {
+    return;
+  }
+
+  // New chunks enter the streamed square on the side the player moves to
+  const glm::ivec3 direction{glm::clamp(movement.x, -1, 1),
+                             0,
+                             glm::clamp(movement.z, -1, 1)};
+  world_.region_storage().prefetch(
+      glm::ivec3{player_chunk_position.x, 0, player_chunk_position.z} +
+      direction * (chunks_around_player_ + 1));
+}
+
+void ChunkStreamer::collect_finished_jobs()
+{
+  std::vector<GeneratedChunk> generated_chunks;
+  std::vector<DecoratedChunk> decorated_chunks;
+  std::vector<MeshedChunk>    meshed_chunks;
+  std::vector<glm::ivec3>     missing_chunks;
+  {
+    std::lock_guard<std::mutex> lock(finished_mutex_);
+    generated_chunks.swap(generated_chunks_);
+    decorated_chunks.swap(decorated_chunks_);
+    meshed_chunks.swap(meshed_chunks_);
+    missing_chunks.swap(missing_chunks_);
+  }
+  in_flight_count_ -= generated_chunks.size() + decorated_chunks.size() +
+                      meshed_chunks.size() + missing_chunks.size();
+  assert(in_flight_count_ >= 0);
+
+  // These stay marked as generating, so nothing else picks them up
+  for (const auto &pos : missing_chunks)
+  {
+    queue_generation(pos, priority(pos));
+  }
+
+  std::size_t  loaded_count    = 0;
+  std::int64_t generation_time = 0;
+  for (const auto &generated_chunk : generated_chunks)
+  {
+    const auto &pos = generated_chunk.position;
+    world_.chunk(pos).set_generating(false);
+    if (generated_chunk.is_loaded)
+    {
+      ++loaded_count;
+    }
+    else
+    {
+      generation_time += generated_chunk.generation_time;
+    }
+    on_chunk_generated(pos);
+  }
+
+  std::size_t  decoration_blocks = 0;
+  std::int64_t decoration_time   = 0;
+  for (const auto &decorated_chunk : decorated_chunks)
+  {
+    decoration_blocks += decorated_chunk.blocks.size();
+    decoration_time += decorated_chunk.decoration_time;
+    on_chunk_decorated(decorated_chunk);
+  }
+
+  for (auto &meshed_chunk : meshed_chunks)
+  {
+    upload_queue_.push_back(std::move(meshed_chunk));
+  }
+
+  if (generated_chunks.size() > loaded_count)
+  {
+    const auto chunk_count = generated_chunks.size() - loaded_count;
+    LOG_DEBUG() << "Generated " << chunk_count << " chunks in "
+                << generation_time / 1000.0f << " ms of worker time ("
+                << generation_time / static_cast<float>(chunk_count)
+                << " us/chunk)";
+  }
+
+  if (!decorated_chunks.empty())
+  {
+    LOG_DEBUG() << "Decorated " << decorated_chunks.size() << " chunks in "
+                << decoration_time / 1000.0f << " ms of worker time ("
+                << decoration_blocks / decorated_chunks.size()
+                << " blocks/chunk)";
+  }
+
+  if (loaded_count > 0)
+  {
+    const auto statistics = world_.region_storage().statistics();
+    LOG_DEBUG() << "Loaded " << loaded_count << " chunks from disk. In total "
+                << statistics.loaded_count << " loaded with "
+                << statistics.load_latency / 1000.0f /
+                       statistics.loaded_count
+                << " ms latency and "
+                << statistics.loaded_bytes / statistics.loaded_count
+                << " bytes/chunk";
+  }
+}
+
+void ChunkStreamer::on_chunk_generated(const glm::ivec3 &chunk_position)
+{
+  // The chunk or a neighbour may be the last one a chunk waited for to get
+  // its trees
+  generation_candidates_.erase(chunk_position);
+  update_decoration_candidate(chunk_position);
+  for (const auto &offset : decoration_offsets)
+  {
+    update_decoration_candidate(chunk_position + offset);
+  }
+
+  // Chunks from disk may have their trees already, the others are meshed
+  // once they are decorated
+  if (world_.chunk(chunk_position).is_decorated())
+  {
+    request_meshing(chunk_position);
+  }
+
+  // A new chunk changes the borders of its neighbours, so these need a new
+  // mesh too
+  for (const auto &offset : neighbour_offsets)
+  {
+    const auto neighbour_pos = chunk_position + offset;
+    if (world_.is_chunk(neighbour_pos) &&
+        world_.chunk(neighbour_pos).is_mesh_requested())
+    {
+      request_meshing(neighbour_pos);
+    }
+  }
+}
+
+void ChunkStreamer::on_chunk_decorated(const DecoratedChunk &decorated_chunk)
+{
+  const auto &pos = decorated_chunk.position;
+  if (!world_.is_chunk(pos))
+  {
+    return;
+  }
+
+  // The chunk or a neighbour may have been unloaded or replaced in the
+  // meantime, then the chunk is queued again later
+  auto &c = world_.chunk(pos);
+  c.set_decorating(false);
+  if (!is_ready_for_decoration(pos))
+  {
+    update_decoration_candidate(pos);
+    return;
+  }
+
+  const auto changed_chunks = world_.place_decoration(decorated_chunk.blocks);
+  c.set_decorated();
+  request_meshing(pos);
+
+  // Neighbours that got leaves or show their border faces against the trees
+  for (const auto &changed_pos : changed_chunks)
+  {
+    if (changed_pos != pos && world_.chunk(changed_pos).is_mesh_requested())
+    {
+      request_meshing(changed_pos);
+    }
+  }
+  for (const auto &offset : neighbour_offsets)
+  {
+    const auto neighbour_pos = pos + offset;
+    if (world_.is_chunk(neighbour_pos) &&
+        world_.chunk(neighbour_pos).is_mesh_requested())
+    {
+      request_meshing(neighbour_pos);
+    }
+  }
+}
+
+bool ChunkStreamer::is_ready_for_decoration(
+    const glm::ivec3 &chunk_position) const
+{
+  const auto *c = world_.generated_chunk(chunk_position);
+  if (c == nullptr || c->is_decorated() || c->is_compressed())
+  {
+    return false;
+  }
+  for (const auto &offset : decoration_offsets)
+  {
+    if (world_.generated_chunk(chunk_position + offset) == nullptr)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+void ChunkStreamer::update_decoration_candidate(
+    const glm::ivec3 &chunk_position)
+{
+  if (!are_candidates_scanned_)
+  {
+    return;
+  }
+
+  if (is_streamed(chunk_position) && is_ready_for_decoration(chunk_position) &&
+      !world_.chunk(chunk_position).is_decorating())
+  {
+    decoration_candidates_.insert(chunk_position);
+  }
+  else
+  {
+    decoration_candidates_.erase(chunk_position);
+  }
+}
+
+void ChunkStreamer::scan_candidates()
+{
+  generation_candidates_.clear();
+  decoration_candidates_.clear();
+  candidates_chunk_position_ = player_chunk_position_;
+  are_candidates_scanned_    = true;
+
+  // The ring around the streamed square only gets its terrain, so the trees
+  // of the outermost streamed chunks can grow into it
+  const auto terrain_radius = chunks_around_player_ + 1;
+  for (int x = player_chunk_position_.x - terrain_radius;
+       x <= player_chunk_position_.x + terrain_radius;
+       ++x)
+  {
+    for (int z = player_chunk_position_.z - terrain_radius;
+         z <= player_chunk_position_.z + terrain_radius;
+         ++z)
+    {
+      // Loading creates the chunks the player moved towards. The keep radius
+      // covers the square, so they stay loaded until the player moves on.
+      const glm::ivec3 pos{x, 0, z};
+      const auto      &c = world_.load_chunk(pos);
+      if (!c.is_generated() && !c.is_generating())
+      {
+        generation_candidates_.insert(pos);
+      }
+      else if (is_streamed(pos) && !c.is_decorating() &&
+               is_ready_for_decoration(pos))
+      {
+        decoration_candidates_.insert(pos);
+      }
+    }
+  }
+}
+
+void ChunkStreamer::remesh_dirty_chunks()
+{
+  if (dirty_chunks_.empty())
+  {
+    return;
+  }
+
+  const auto avoided_before = remesh_counters_.avoided;
+  for (const auto &pos : dirty_chunks_)
+  {
+    if (!world_.is_chunk(pos))
+    {
+      continue;
+    }
+
+    auto &c = world_.chunk(pos);
+    if (!c.is_mesh_generated())
+    {
+      // Keeps its place in the meshing queue, if it has one
+      continue;
+    }
+
+    // The mesh below covers a queued request too
+    if (meshing_queue_set_.erase(pos) > 0)
+    {
+      ++remesh_counters_.avoided;
+    }
+
+    c.regenerate_mesh(world_);
+  }
+
+  LOG_DEBUG() << "Re-meshed " << dirty_chunks_.size() << " dirty chunks, "
+              << remesh_counters_.avoided - avoided_before
+              << " redundant re-meshes avoided this frame ("
+              << remesh_counters_.avoided << " of "
+              << remesh_counters_.requested << " requests in total)";
+  dirty_chunks_.clear();
+  dirty_chunks_set_.clear();
+  prune_meshing_queue();
+}
+
+void ChunkStreamer::prune_meshing_queue()
+{
+  if (meshing_queue_.size() == meshing_queue_set_.size())
+  {
+    return;
+  }
+
+  const auto is_removed = [this](const glm::ivec3 &pos)
+  { return meshing_queue_set_.find(pos) == meshing_queue_set_.end(); };
+  meshing_queue_.erase(
+      std::remove_if(meshing_queue_.begin(), meshing_queue_.end(), is_removed),
+      meshing_queue_.end());
+}
+
+void ChunkStreamer::dispatch_jobs()
+{
+  // Equal priorities are dispatched in this order. Meshes of decorated
+  // chunks show up right away, so they come first.
+  enum class JobType
+  {
+    Meshing,
+    Decoration,
+    Generation,
+  };
+
+  struct Candidate
+  {
+    float      priority;
+    JobType    type;
+    glm::ivec3 position;
+  };
+  std::vector<Candidate> candidates;
+
+  if (!are_candidates_scanned_ ||
+      candidates_chunk_position_ != player_chunk_position_)
+  {
+    scan_candidates();
+  }
+
+  // The priorities follow the view direction, so they are computed again
+  for (const auto &pos : generation_candidates_)
+  {
+    candidates.push_back({priority(pos), JobType::Generation, pos});
+  }
+  for (const auto &pos : decoration_candidates_)
+  {
+    candidates.push_back({priority(pos), JobType::Decoration, pos});
+  }
+
+  // Drop chunks that were unloaded since they were queued
+  for (const auto &pos : meshing_queue_)
+  {
+    if (world_.generated_chunk(pos) == nullptr)
+    {
+      meshing_queue_set_.erase(pos);
+    }
+  }
+  prune_meshing_queue();
+
+  for (const auto &pos : meshing_queue_)
+  {
+    candidates.push_back({priority(pos), JobType::Meshing, pos});
+  }
+
+  const auto free_slots = std::min<std::size_t>(
+      std::max(max_jobs_in_flight_ - in_flight_count_, 0),
+      candidates.size());
+  if (free_slots == 0)
+  {
+    return;
+  }
+
+  std::partial_sort(candidates.begin(),
+                    candidates.begin() + free_slots,
+                    candidates.end(),
+                    [](const Candidate &a, const Candidate &b)
+                    {
+                      if (a.priority != b.priority)
+                      {
+                        return a.priority < b.priority;
+                      }
+                      return a.type < b.type;
+                    });
+
+  for (std::size_t i = 0; i < free_slots; ++i)
+  {
+    const auto &candidate = candidates[i];
+    switch (candidate.type)
+    {
+    case JobType::Meshing:
+      meshing_queue_set_.erase(candidate.position);
+      queue_meshing(candidate.position, candidate.priority);
+      break;
+    case JobType::Decoration:
+      decoration_candidates_.erase(candidate.position);
+      queue_decoration(candidate.position, candidate.priority);
+      break;
+    case JobType::Generation:
+      generation_candidates_.erase(candidate.position);
+      queue_loading(candidate.position, candidate.priority);
+      break;
+    }
+  }
+  prune_meshing_queue();
+}
+
+int ChunkStreamer::upload_meshes()
+{
+  const auto start_time = current_time_micros();
+
+  // Closest meshes first, the player may have moved since they were queued
+  std::sort(upload_queue_.begin(),
+            upload_queue_.end(),
+            [this](const MeshedChunk &a, const MeshedChunk &b)
+            { return priority(a.position) < priority(b.position); });
+
+  int          upload_count = 0;
+  std::size_t  upload_bytes = 0;
+  int          face_count       = 0;
+  int          quad_count       = 0;
+  int          allocation_count = 0;
+  std::int64_t meshing_time     = 0;
+
+  // Upload at least one mesh per frame, so streaming never stalls
+  auto it = upload_queue_.begin();
+  for (; it != upload_queue_.end(); ++it)
+  {
+    if (upload_count > 0 &&
+        (current_time_micros() - start_time >= upload_budget_ms_ * 1000.0f ||
+         upload_bytes >= upload_budget_kib_ * 1024u))
+    {
+      break;
+    }
+
+    // The chunk was unloaded or a newer mesh was requested in the meantime
+    if (!world_.is_chunk(it->position))
+    {
+      continue;
+    }
+    auto &c = world_.chunk(it->position);
+    if (it->revision != c.mesh_revision())
+    {
+      continue;
+    }
+
+    const auto &mesh_data = it->mesh_data;
+    c.upload_mesh(mesh_data);
+
+    ++upload_count;
+    upload_bytes += mesh_data.memory_usage();
+    face_count += mesh_data.face_count;
+    quad_count += mesh_data.quad_count;
+    allocation_count += mesh_data.allocation_count;
+    meshing_time += it->meshing_time;
+  }
+
+  // Hands the buffers back to the workers. There are never more meshes in
+  // the making than jobs in flight, so more spares would only hold memory.
+  {
+    std::lock_guard<std::mutex> lock(finished_mutex_);
+    for (auto spare = upload_queue_.begin(); spare != it; ++spare)
+    {
+      if (spare_mesh_data_.size() >=
+          static_cast<std::size_t>(max_jobs_in_flight_))
+      {
+        break;
+      }
+      spare_mesh_data_.push_back(std::move(spare->mesh_data));
+    }
+  }
+  upload_queue_.erase(upload_queue_.begin(), it);
+
+  if (upload_count == 0)
+  {
+    return 0;
+  }
+
+  const auto upload_time = current_time_micros() - start_time;
+  const auto depths      = queue_depths();
+  LOG_DEBUG() << "Uploaded " << upload_count << " chunk meshes ("
+              << upload_bytes / 1024.0f << " KiB) in " << upload_time
+              << " us. Meshing took "
+              << meshing_time / static_cast<float>(upload_count)
+              << " us/chunk on the workers. Queued: " << depths.generation
+              << " generation, " << depths.meshing << " meshing, "
+              << depths.in_flight << " in flight, " << depths.upload
+              << " upload";
+  LOG_DEBUG() << "Chunk meshes: " << quad_count / upload_count
+              << " quads per chunk for " << face_count / upload_count
+              << " block faces ("
+              << (face_count > 0 ? 100.0f - 100.0f * quad_count / face_count
+                                 : 0.0f)
+              << "% fewer triangles and vertices), "
+              << upload_bytes / upload_count / 1024.0f
+              << " KiB on the GPU with " << sizeof(ChunkVertex)
+              << " byte vertices, "
+              << allocation_count / static_cast<float>(upload_count)
+              << " buffer allocations per mesh";
+
+  return upload_count;
+}
+
+void ChunkStreamer::queue_loading(const glm::ivec3 &chunk_position,
+                                  float /*priority*/)
+{
+  auto &c = world_.chunk(chunk_position);
+  c.set_generating(true);
+  ++in_flight_count_;
+
+  // Runs in request order on the I/O thread, so the priority does not apply
+  world_.region_storage().load(
+      chunk_position,
+      [this, &c, chunk_position](ByteSpan data)
+      {
+        const auto is_loaded = load_chunk_data(c, data);
+
+        std::lock_guard<std::mutex> lock(finished_mutex_);
+        if (is_loaded)
+        {
+          generated_chunks_.push_back({chunk_position, 0, true});
+        }
+        else
+        {
+          missing_chunks_.push_back(chunk_position);
+        }
+      });
+}
+
+void ChunkStreamer::queue_generation(const glm::ivec3 &chunk_position,
+                                     float             priority)
+{
+  auto &c = world_.chunk(chunk_position);
+  c.set_generating(true);
+  ++in_flight_count_;
+
+  worker_pool_->submit(
+      priority,
+      [this, &c, chunk_position]()
+      {
+        const auto start_time = current_time_micros();
+        c.generate(chunk_position, world_);
+        const auto generation_time = current_time_micros() - start_time;
+
+        std::lock_guard<std::mutex> lock(finished_mutex_);
+        generated_chunks_.push_back({chunk_position, generation_time, false});
+      });
+}
+
+void ChunkStreamer::queue_decoration(const glm::ivec3 &chunk_position,
+                                     float             priority)
+{
+  world_.chunk(chunk_position).set_decorating(true);
+  ++in_flight_count_;
+
+  // Only reads the heightmap, the blocks are placed on the main thread
+  const glm::ivec2 heightmap_position{chunk_position.x, chunk_position.z};
+  worker_pool_->submit(
+      priority,
+      [this, chunk_position, heightmap_position]()
+      {
+        const auto start_time = current_time_micros();
+        const auto heightmap  = world_.heightmap(heightmap_position);
+        auto blocks = world_.chunk_decorator().decorate(chunk_position,
+                                                        *heightmap);
+        const auto decoration_time = current_time_micros() - start_time;
+
+        std::lock_guard<std::mutex> lock(finished_mutex_);
+        decorated_chunks_.push_back(
+            {chunk_position, std::move(blocks), decoration_time});
+      });
+}
+
+void ChunkStreamer::queue_meshing(const glm::ivec3 &chunk_position,
+                                  float             priority)
+{
+  auto      &c        = world_.chunk(chunk_position);
+  const auto revision = c.next_mesh_revision();
+  ++in_flight_count_;
+
+  // The snapshot is taken now, so the worker never touches the chunk
+  const auto snapshot = std::make_shared<const ChunkSnapshot>(c, world_);
+
+  worker_pool_->submit(
+      priority,
+      [this, snapshot, chunk_position, revision]()
+      {
+        ChunkMeshData mesh_data;
+        {
+          std::lock_guard<std::mutex> lock(finished_mutex_);
+          if (!spare_mesh_data_.empty())
+          {
+            mesh_data = std::move(spare_mesh_data_.back());
+            spare_mesh_data_.pop_back();
+          }
+        }
+
+        const auto start_time = current_time_micros();
+        world_.chunk_mesher().mesh(*snapshot, mesh_data);
+        const auto meshing_time = current_time_micros() - start_time;
+
+        std::lock_guard<std::mutex> lock(finished_mutex_);
+        meshed_chunks_.push_back(
+            {chunk_position, revision, std::move(mesh_data), meshing_time});
+      });
+}
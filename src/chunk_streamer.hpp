@@ -0,0 +1,183 @@
+#pragma once
+
+#include "chunk_decorator.hpp"
+#include "chunk_mesher.hpp"
+#include "math.hpp"
+#include "settings.hpp"
+#include "thread_pool.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+class World;
+
+// Streams in the chunks around the player. Generation, decoration and
+// meshing run on a worker pool, finished meshes are uploaded on the main
+// thread. Work close to the player and in view direction is done first.
+//
+// Chunks are generated in two phases. The terrain is generated for the
+// streamed square and one ring of chunks around it. Once the terrain of all
+// eight neighbours of a chunk is there, a worker computes its trees, which
+// the main thread then places across the chunk borders. Chunks are meshed
+// after they were decorated.
+class ChunkStreamer
+{
+public:
+  struct QueueDepths
+  {
+    // Chunks around the player that still need to be loaded or generated
+    int generation;
+    // Chunks whose neighbours are generated and that wait for their trees
+    int decoration;
+    // Chunks that wait for a mesh job
+    int meshing;
+    // Jobs the workers did not finish yet
+    int in_flight;
+    // Finished meshes that wait for upload
+    int upload;
+  };
+
+  struct RemeshCounters
+  {
+    // Mesh requests for chunks, including the ones that were merged
+    int requested;
+    // Requests for chunks that were already queued or dirty
+    int avoided;
+  };
+
+  explicit ChunkStreamer(World &world);
+  ~ChunkStreamer();
+
+  // Needs to be called once per frame on the main thread. Returns the number
+  // of chunk meshes that were uploaded.
+  int update(const glm::ivec3 &player_chunk_position,
+             const glm::vec3  &view_direction);
+
+  // Takes over the limits and weights, the radius and the number of workers
+  // stay as they were at construction
+  void apply_settings(const WorldSettings &settings);
+
+  // Queues a new mesh for a generated chunk
+  void request_meshing(const glm::ivec3 &chunk_position);
+
+  // Re-meshes a meshed chunk on the main thread during the next update. A
+  // chunk is re-meshed at most once per frame, however often it is marked.
+  void mark_dirty(const glm::ivec3 &chunk_position);
+
+  QueueDepths queue_depths() const;
+
+  // Totals since the start
+  RemeshCounters remesh_counters() const;
+
+  int worker_count() const;
+
+  // Radius in chunks of the square around the player that is streamed in
+  int chunks_around_player() const;
+
+private:
+  struct GeneratedChunk
+  {
+    glm::ivec3   position;
+    std::int64_t generation_time;
+    // Read from disk instead of generated
+    bool is_loaded;
+  };
+
+  struct DecoratedChunk
+  {
+    glm::ivec3                   position;
+    std::vector<DecorationBlock> blocks;
+    std::int64_t                 decoration_time;
+  };
+
+  struct MeshedChunk
+  {
+    glm::ivec3    position;
+    unsigned      revision;
+    ChunkMeshData mesh_data;
+    std::int64_t  meshing_time;
+  };
+
+  World &world_;
+
+  int chunks_around_player_ = 16;
+  // Jobs handed to the workers at once. Keeping this low lets the order
+  // follow the player.
+  int max_jobs_in_flight_ = 0;
+
+  // Per frame limits for uploading finished meshes
+  float upload_budget_ms_  = 2.0f;
+  int   upload_budget_kib_ = 4096;
+
+  // How much further away chunks behind the player count, 0 ignores the view
+  // direction
+  float view_weight_ = 1.0f;
+
+  glm::ivec3 player_chunk_position_{0};
+  glm::vec2  view_direction_{0.0f};
+
+  using ChunkPositionSet = std::unordered_set<glm::ivec3, ChunkPositionHash>;
+
+  // Only touched on the main thread. The sets hold the chunks of the queue
+  // next to them, so duplicates are found without a search.
+  std::vector<glm::ivec3>  meshing_queue_;
+  ChunkPositionSet         meshing_queue_set_;
+  std::vector<glm::ivec3>  dirty_chunks_;
+  ChunkPositionSet         dirty_chunks_set_;
+  std::vector<MeshedChunk> upload_queue_;
+  int                      in_flight_count_ = 0;
+  RemeshCounters           remesh_counters_{};
+
+  // Chunks that wait for their terrain or their trees. The square around the
+  // player is only walked for them when the player enters another chunk,
+  // finished jobs update the chunks they affect.
+  ChunkPositionSet generation_candidates_;
+  ChunkPositionSet decoration_candidates_;
+  glm::ivec3       candidates_chunk_position_{0};
+  bool             are_candidates_scanned_ = false;
+
+  // Results of the workers, guarded by the mutex
+  std::mutex                  finished_mutex_;
+  std::vector<GeneratedChunk> generated_chunks_;
+  std::vector<DecoratedChunk> decorated_chunks_;
+  std::vector<MeshedChunk>    meshed_chunks_;
+  // Buffers of uploaded meshes, the workers mesh into them again
+  std::vector<ChunkMeshData> spare_mesh_data_;
+  // Chunks that were not found on disk and need to be generated
+  std::vector<glm::ivec3> missing_chunks_;
+
+  std::unique_ptr<ThreadPool> worker_pool_;
+
+  float priority(const glm::ivec3 &chunk_position) const;
+  // Whether the chunk is within the square around the player that is meshed
+  bool is_streamed(const glm::ivec3 &chunk_position) const;
+
+  // Reads the region files ahead of the player's movement
+  void prefetch_regions(const glm::ivec3 &player_chunk_position);
+
+  void collect_finished_jobs();
+  void on_chunk_generated(const glm::ivec3 &chunk_position);
+  void on_chunk_decorated(const DecoratedChunk &decorated_chunk);
+  // Whether the chunk waits for its trees and the terrain of all eight
+  // neighbours is generated
+  bool is_ready_for_decoration(const glm::ivec3 &chunk_position) const;
+  // Adds the chunk to the decoration candidates or removes it
+  void update_decoration_candidate(const glm::ivec3 &chunk_position);
+  // Walks the square around the player for chunks to generate and decorate
+  void scan_candidates();
+  void remesh_dirty_chunks();
+  // Removes the chunks that were taken out of meshing_queue_set_ from the
+  // meshing queue
+  void prune_meshing_queue();
+  void dispatch_jobs();
+  int  upload_meshes();
+
+  // Loads the chunk from disk, or generates it if it was never saved
+  void queue_loading(const glm::ivec3 &chunk_position, float priority);
+  void queue_generation(const glm::ivec3 &chunk_position, float priority);
+  void queue_decoration(const glm::ivec3 &chunk_position, float priority);
+  void queue_meshing(const glm::ivec3 &chunk_position, float priority);
+};
@@ -14,12 +14,18 @@ GLuint GlIndexBuffer::id() const { return index_buffer_id_; }
 
 void GlIndexBuffer::set_data(const std::vector<unsigned> &indices)
 {
+  const auto size = static_cast<GLsizeiptr>(indices.size() * sizeof(unsigned));
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_id_);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_id_);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-               indices.size() * sizeof(unsigned),
-               indices.data(),
-               GL_STATIC_DRAW);
+  // The storage only grows, smaller data is written into the existing one
+  if (size > capacity_)
+  {
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, indices.data(), GL_STATIC_DRAW);
+    capacity_ = size;
+  }
+  else
+  {
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, size, indices.data());
+  }
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
   count_ = indices.size();
@@ -17,8 +17,9 @@ public:
   GLsizei count() const;
 
 private:
-  GLuint  index_buffer_id_{};
-  GLsizei count_{};
+  GLuint     index_buffer_id_{};
+  GLsizei    count_{};
+  GLsizeiptr capacity_{};
 
   GlIndexBuffer(const GlIndexBuffer &) = delete;
   void operator=(const GlIndexBuffer &) = delete;
@@ -158,6 +158,9 @@ void GlShader::init(const std::filesystem::path &vertex_shader_file_path,
     case GL_INT:
       glVertexAttribIFormat(i, 1, GL_INT, 0);
       break;
+    case GL_UNSIGNED_INT_VEC2:
+      glVertexAttribIFormat(i, 2, GL_UNSIGNED_INT, 0);
+      break;
     default:
       assert(0 && "Can not handle Glsl type");
     }
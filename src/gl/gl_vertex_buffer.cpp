@@ -14,6 +14,13 @@ void GlVertexBufferLayout::push_int(unsigned count)
   elements_.push_back(element);
 }
 
+void GlVertexBufferLayout::push_uint(unsigned count)
+{
+  GlVertexBufferLayoutElement element{};
+  element.stride = count * sizeof(unsigned);
+  elements_.push_back(element);
+}
+
 std::vector<GlVertexBufferLayoutElement> GlVertexBufferLayout::elements() const
 {
   return elements_;
@@ -14,6 +14,7 @@ class GlVertexBufferLayout
 public:
   void push_float(unsigned count);
   void push_int(unsigned count);
+  void push_uint(unsigned count);
 
   std::vector<GlVertexBufferLayoutElement> elements() const;
 
@@ -34,8 +35,18 @@ public:
                 const GlVertexBufferLayout layout,
                 GLenum                     usage = GL_STATIC_DRAW)
   {
+    const auto size = static_cast<GLsizeiptr>(data.size() * sizeof(T));
     glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_id_);
-    glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(T), data.data(), usage);
+    // The storage only grows, smaller data is written into the existing one
+    if (size > capacity_)
+    {
+      glBufferData(GL_ARRAY_BUFFER, size, data.data(), usage);
+      capacity_ = size;
+    }
+    else
+    {
+      glBufferSubData(GL_ARRAY_BUFFER, 0, size, data.data());
+    }
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 
     vertex_count_ = data.size();
@@ -51,7 +62,8 @@ private:
 
   GlVertexBufferLayout layout_;
 
-  GLsizei vertex_count_{};
+  GLsizei    vertex_count_{};
+  GLsizeiptr capacity_{};
 
   GlVertexBuffer(const GlVertexBuffer &) = delete;
   void operator=(const GlVertexBuffer &) = delete;
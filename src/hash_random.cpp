@@ -0,0 +1,41 @@
+#include "hash_random.hpp"
+
+#include <cassert>
+
+namespace
+{
+// Finalizer of SplitMix64, every input bit affects every output bit
+std::uint64_t mix(std::uint64_t value)
+{
+  value ^= value >> 30;
+  value *= 0xbf58476d1ce4e5b9;
+  value ^= value >> 27;
+  value *= 0x94d049bb133111eb;
+  value ^= value >> 31;
+  return value;
+}
+
+constexpr std::uint64_t golden_gamma = 0x9e3779b97f4a7c15;
+} // namespace
+
+HashRandom::HashRandom(std::uint64_t seed, int x, int z)
+{
+  const auto column = (std::uint64_t{static_cast<std::uint32_t>(x)} << 32) |
+                      static_cast<std::uint32_t>(z);
+  key_ = mix(mix(seed + golden_gamma) ^ column);
+}
+
+std::uint32_t HashRandom::next()
+{
+  ++counter_;
+  return static_cast<std::uint32_t>(mix(key_ + counter_ * golden_gamma) >> 32);
+}
+
+int HashRandom::uniform_int(int min, int max)
+{
+  assert(min <= max);
+  const auto range =
+      static_cast<std::uint64_t>(static_cast<std::int64_t>(max) - min) + 1;
+  // Scales the number to the range without a division
+  return min + static_cast<int>((next() * range) >> 32);
+}
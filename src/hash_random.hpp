@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+// Counter based random numbers for world generation. Every number is a hash
+// of the world seed, a block column and how many numbers were drawn for the
+// column before, so it does not depend on which thread generates what in
+// which order. Construction is free, unlike a std::mt19937.
+class HashRandom
+{
+public:
+  HashRandom(std::uint64_t seed, int x, int z);
+
+  std::uint32_t next();
+
+  // Uniform in [min, max]. The bias is below 2^-24 for the small ranges
+  // generation uses.
+  int uniform_int(int min, int max);
+
+private:
+  std::uint64_t key_;
+  std::uint64_t counter_ = 0;
+};
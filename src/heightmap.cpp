@@ -0,0 +1,158 @@
+#include "heightmap.hpp"
+#include "application.hpp"
+#include "chunk.hpp"
+#include "simplex_noise.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+int ChunkHeightmap::height(int x, int z) const
+{
+  assert(0 <= x && x < width && 0 <= z && z < width);
+  return heights[x * width + z];
+}
+
+Biome ChunkHeightmap::biome(int x, int z) const
+{
+  assert(0 <= x && x < width && 0 <= z && z < width);
+  return biomes[x * width + z];
+}
+
+HeightmapCache::HeightmapCache()
+{
+  const auto settings = Application::instance()->settings();
+
+  c1_           = settings->chunk.c1;
+  c2_           = settings->chunk.c2;
+  c3_           = settings->chunk.c3;
+  div_          = settings->chunk.div;
+  frequency1_   = settings->chunk.frequency1;
+  frequency2_   = settings->chunk.frequency2;
+  frequency3_   = settings->chunk.frequency3;
+  e_            = settings->chunk.e;
+  fudge_factor_ = settings->chunk.fudge_factor;
+  water_level_  = settings->chunk.water_level;
+  terraces_     = settings->chunk.terraces;
+}
+
+std::shared_ptr<const ChunkHeightmap>
+HeightmapCache::heightmap(const glm::ivec2 &chunk_position)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto                  it = heightmaps_.find(chunk_position);
+    if (it != heightmaps_.end())
+    {
+      ++hit_count_;
+      lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+      return it->second.heightmap;
+    }
+    ++miss_count_;
+  }
+
+  // Computed without holding the lock. Two threads may compute the same
+  // heightmap, they get the same result.
+  auto heightmap = compute(chunk_position);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (heightmaps_.count(chunk_position) == 0)
+  {
+    lru_.push_front(chunk_position);
+    heightmaps_.emplace(chunk_position,
+                        CachedHeightmap{heightmap, lru_.begin()});
+    if (heightmaps_.size() > max_cached_heightmaps)
+    {
+      heightmaps_.erase(lru_.back());
+      lru_.pop_back();
+    }
+  }
+  return heightmap;
+}
+
+int HeightmapCache::surface_height(int x, int z)
+{
+  // Shifting right rounds towards negative infinity, so block -1 is in
+  // chunk -1
+  constexpr auto   width_mask = Chunk::width() - 1;
+  const glm::ivec2 chunk_position{x >> Chunk::width_shift,
+                                  z >> Chunk::width_shift};
+  return heightmap(chunk_position)->height(x & width_mask, z & width_mask);
+}
+
+HeightmapCache::Statistics HeightmapCache::statistics() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return {heightmaps_.size(), hit_count_, miss_count_};
+}
+
+std::size_t
+HeightmapCache::PositionHash::operator()(const glm::ivec2 &position) const
+{
+  const auto x = static_cast<std::uint32_t>(position.x);
+  const auto z = static_cast<std::uint32_t>(position.y);
+  return std::hash<std::uint64_t>{}((std::uint64_t{x} << 32) | z);
+}
+
+std::shared_ptr<const ChunkHeightmap>
+HeightmapCache::compute(const glm::ivec2 &chunk_position) const
+{
+  const auto width = Chunk::width();
+
+  auto heightmap         = std::make_shared<ChunkHeightmap>();
+  heightmap->width       = width;
+  heightmap->water_level = water_level_;
+  heightmap->heights.resize(width * width);
+  heightmap->biomes.resize(width * width);
+
+  // The octaves of all columns are evaluated at once
+  const auto         column_count = static_cast<std::size_t>(width) * width;
+  std::vector<float> octave_x(3 * column_count);
+  std::vector<float> octave_z(3 * column_count);
+  std::vector<float> octave_noise(3 * column_count);
+  for (int x = 0; x < width; ++x)
+  {
+    for (int z = 0; z < width; ++z)
+    {
+      // Noise is sampled at the center of the column
+      const auto position_x = chunk_position.x * width + x + 0.5f;
+      const auto position_z = chunk_position.y * width + z + 0.5f;
+
+      const auto column = x * width + z;
+
+      octave_x[column]                    = position_x * frequency1_ - 1.3f;
+      octave_z[column]                    = position_z * frequency1_;
+      octave_x[column_count + column]     = position_x * frequency2_ + 1.1f;
+      octave_z[column_count + column]     = position_z * frequency2_ + 2.0f;
+      octave_x[2 * column_count + column] = position_x * frequency3_ + 5.3f;
+      octave_z[2 * column_count + column] = position_z * frequency3_ + 0.2f;
+    }
+  }
+  simplex_noise_2d(octave_x.data(),
+                   octave_z.data(),
+                   octave_noise.data(),
+                   octave_noise.size());
+
+  for (std::size_t column = 0; column < column_count; ++column)
+  {
+    const auto noise = c1_ * octave_noise[column] +
+                       c2_ * octave_noise[column_count + column] +
+                       c3_ * octave_noise[2 * column_count + column];
+
+    auto normalized_noise =
+        (noise + c1_ + c2_ + c3_) / (((2.0f * (c1_ + c2_ + c3_))) * div_);
+
+    normalized_noise = glm::pow(normalized_noise * fudge_factor_, e_);
+    normalized_noise = glm::round(normalized_noise * terraces_) / terraces_;
+
+    const auto height =
+        std::clamp(static_cast<int>(normalized_noise * Chunk::height()),
+                   0,
+                   Chunk::height() - 1);
+
+    heightmap->heights[column] = height;
+    heightmap->biomes[column] =
+        height < water_level_ ? Biome::Lake : Biome::Grassland;
+  }
+
+  return heightmap;
+}
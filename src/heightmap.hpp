@@ -0,0 +1,95 @@
+#pragma once
+
+#include "math.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// What the terrain surface of a column looks like
+enum class Biome : std::uint8_t
+{
+  // The surface is below the water level and covered with water
+  Lake,
+  // Grass with trees on top
+  Grassland,
+};
+
+// Terrain height and biome of every column of one chunk, x major
+struct ChunkHeightmap
+{
+  int                       width{};
+  // Columns up to the water level are filled with water
+  float                     water_level{};
+  std::vector<std::int16_t> heights;
+  std::vector<Biome>        biomes;
+
+  // y of the highest terrain block of the column, trees and water are not
+  // included
+  [[nodiscard]] int   height(int x, int z) const;
+  [[nodiscard]] Biome biome(int x, int z) const;
+};
+
+// Computes the terrain heightmaps from the noise settings in [Chunk] and
+// keeps the recently used ones. Can be used from several threads.
+class HeightmapCache
+{
+public:
+  struct Statistics
+  {
+    std::size_t cached_count;
+    std::size_t hit_count;
+    std::size_t miss_count;
+  };
+
+  HeightmapCache();
+
+  std::shared_ptr<const ChunkHeightmap>
+  heightmap(const glm::ivec2 &chunk_position);
+
+  // Terrain height at a block position in the world
+  int surface_height(int x, int z);
+
+  Statistics statistics() const;
+
+private:
+  struct PositionHash
+  {
+    std::size_t operator()(const glm::ivec2 &position) const;
+  };
+
+  struct CachedHeightmap
+  {
+    std::shared_ptr<const ChunkHeightmap> heightmap;
+    std::list<glm::ivec2>::iterator       lru_position;
+  };
+
+  // A heightmap of 16x16 columns takes less than 1 KiB
+  static constexpr std::size_t max_cached_heightmaps = 4096;
+
+  float c1_;
+  float c2_;
+  float c3_;
+  float div_;
+  float frequency1_;
+  float frequency2_;
+  float frequency3_;
+  float e_;
+  float fudge_factor_;
+  float water_level_;
+  float terraces_;
+
+  mutable std::mutex mutex_;
+  std::unordered_map<glm::ivec2, CachedHeightmap, PositionHash> heightmaps_;
+  // Most recently used first
+  std::list<glm::ivec2> lru_;
+  std::size_t           hit_count_  = 0;
+  std::size_t           miss_count_ = 0;
+
+  std::shared_ptr<const ChunkHeightmap>
+  compute(const glm::ivec2 &chunk_position) const;
+};
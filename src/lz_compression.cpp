@@ -0,0 +1,200 @@
+#include "lz_compression.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+// Shorter matches cost more than the literals they replace
+constexpr std::size_t min_match_length = 4;
+// Offsets are stored in two bytes
+constexpr std::size_t max_offset = 65535;
+// Lengths up to this fit into the token, longer ones continue in extra bytes
+constexpr std::size_t token_length_limit = 15;
+
+constexpr int hash_bits = 12;
+
+std::uint32_t read_u32(const std::uint8_t *data)
+{
+  std::uint32_t value{};
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+std::uint32_t hash(std::uint32_t value)
+{
+  return (value * 2654435761u) >> (32 - hash_bits);
+}
+
+void write_length(std::vector<std::uint8_t> &output, std::size_t length)
+{
+  while (length >= 255)
+  {
+    output.push_back(255);
+    length -= 255;
+  }
+  output.push_back(length);
+}
+
+// A match length of 0 marks the last sequence, which only has literals
+void write_sequence(std::vector<std::uint8_t> &output,
+                    const std::uint8_t        *literals,
+                    std::size_t                literal_count,
+                    std::size_t                offset,
+                    std::size_t                match_length)
+{
+  const auto match_token_length =
+      match_length > 0 ? match_length - min_match_length : 0;
+  output.push_back(
+      (std::min(literal_count, token_length_limit) << 4) |
+      std::min(match_token_length, token_length_limit));
+  if (literal_count >= token_length_limit)
+  {
+    write_length(output, literal_count - token_length_limit);
+  }
+  output.insert(output.end(), literals, literals + literal_count);
+
+  if (match_length == 0)
+  {
+    return;
+  }
+
+  output.push_back(offset & 0xff);
+  output.push_back(offset >> 8);
+  if (match_token_length >= token_length_limit)
+  {
+    write_length(output, match_token_length - token_length_limit);
+  }
+}
+} // namespace
+
+std::vector<std::uint8_t> lz_compress(ByteSpan data)
+{
+  std::vector<std::uint8_t> output;
+  output.reserve(data.size / 2 + 16);
+
+  // Last position of every hashed 4 byte sequence
+  std::array<std::uint32_t, 1 << hash_bits> positions{};
+
+  std::size_t position      = 0;
+  std::size_t literal_start = 0;
+  while (position + min_match_length <= data.size)
+  {
+    const auto value     = read_u32(data.data + position);
+    auto      &candidate = positions[hash(value)];
+    const auto match     = static_cast<std::size_t>(candidate);
+    candidate            = position;
+
+    // The hash may collide, so compare the bytes too
+    if (match >= position || position - match > max_offset ||
+        read_u32(data.data + match) != value)
+    {
+      ++position;
+      continue;
+    }
+
+    auto length = min_match_length;
+    while (position + length < data.size &&
+           data.data[match + length] == data.data[position + length])
+    {
+      ++length;
+    }
+
+    write_sequence(output,
+                   data.data + literal_start,
+                   position - literal_start,
+                   position - match,
+                   length);
+    position += length;
+    literal_start = position;
+  }
+
+  write_sequence(output,
+                 data.data + literal_start,
+                 data.size - literal_start,
+                 0,
+                 0);
+  return output;
+}
+
+void lz_decompress(ByteSpan                   data,
+                   std::size_t                size,
+                   std::vector<std::uint8_t> &output)
+{
+  output.resize(size);
+
+  std::size_t input_position  = 0;
+  std::size_t output_position = 0;
+
+  const auto read_byte = [&]() -> std::uint8_t
+  {
+    if (input_position >= data.size)
+    {
+      throw std::runtime_error("Compressed data ends unexpectedly");
+    }
+    return data.data[input_position++];
+  };
+
+  const auto read_length = [&](std::size_t length)
+  {
+    if (length == token_length_limit)
+    {
+      std::uint8_t byte{};
+      do
+      {
+        byte = read_byte();
+        length += byte;
+      } while (byte == 255);
+    }
+    return length;
+  };
+
+  while (true)
+  {
+    const auto token = read_byte();
+
+    const auto literal_count = read_length(token >> 4);
+    if (literal_count > data.size - input_position ||
+        literal_count > size - output_position)
+    {
+      throw std::runtime_error("Compressed data is corrupt");
+    }
+    std::copy_n(data.data + input_position,
+                literal_count,
+                output.data() + output_position);
+    input_position += literal_count;
+    output_position += literal_count;
+
+    // The last sequence has no match
+    if (input_position == data.size)
+    {
+      break;
+    }
+
+    const std::size_t offset_low = read_byte();
+    const auto        offset     = offset_low | (read_byte() << 8);
+    const auto        match_length =
+        read_length(token & 0x0f) + min_match_length;
+    if (offset == 0 || offset > output_position ||
+        match_length > size - output_position)
+    {
+      throw std::runtime_error("Compressed data is corrupt");
+    }
+
+    // Byte by byte, the match may overlap the output it creates
+    auto       *destination = output.data() + output_position;
+    const auto *source      = destination - offset;
+    for (std::size_t i = 0; i < match_length; ++i)
+    {
+      destination[i] = source[i];
+    }
+    output_position += match_length;
+  }
+
+  if (output_position != size)
+  {
+    throw std::runtime_error("Compressed data has the wrong size");
+  }
+}
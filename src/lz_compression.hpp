@@ -0,0 +1,18 @@
+#pragma once
+
+#include "byte_span.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Fast byte oriented LZ77 compression in the spirit of LZ4. The data is a
+// sequence of literal bytes followed by a copy of earlier output. Overlapping
+// copies repeat short patterns, which suits run length encoded data.
+std::vector<std::uint8_t> lz_compress(ByteSpan data);
+
+// size is the size of the uncompressed data. Throws std::runtime_error if the
+// data is corrupt.
+void lz_decompress(ByteSpan                   data,
+                   std::size_t                size,
+                   std::vector<std::uint8_t> &output);
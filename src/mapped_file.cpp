@@ -0,0 +1,133 @@
+#include "mapped_file.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef WIN32
+#include <Windows.h>
+#else // WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // WIN32
+
+#ifdef WIN32
+MappedFile::MappedFile(const std::filesystem::path &path)
+{
+  file_ = CreateFileW(path.c_str(),
+                      GENERIC_READ,
+                      FILE_SHARE_READ | FILE_SHARE_WRITE,
+                      nullptr,
+                      OPEN_EXISTING,
+                      FILE_FLAG_RANDOM_ACCESS,
+                      nullptr);
+  if (file_ == INVALID_HANDLE_VALUE)
+  {
+    file_ = nullptr;
+    throw std::runtime_error("Could not open " + path.string());
+  }
+
+  LARGE_INTEGER size{};
+  GetFileSizeEx(file_, &size);
+  size_ = static_cast<std::size_t>(size.QuadPart);
+  if (size_ == 0)
+  {
+    return;
+  }
+
+  mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping_ != nullptr)
+  {
+    data_ = static_cast<const std::uint8_t *>(
+        MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+  }
+  if (data_ == nullptr)
+  {
+    if (mapping_ != nullptr)
+    {
+      CloseHandle(mapping_);
+    }
+    CloseHandle(file_);
+    throw std::runtime_error("Could not map " + path.string());
+  }
+}
+
+MappedFile::~MappedFile()
+{
+  if (data_ != nullptr)
+  {
+    UnmapViewOfFile(data_);
+    CloseHandle(mapping_);
+  }
+  if (file_ != nullptr)
+  {
+    CloseHandle(file_);
+  }
+}
+
+void MappedFile::prefetch(std::size_t /*offset*/, std::size_t /*size*/) const
+{
+  // FILE_FLAG_RANDOM_ACCESS already keeps the cache manager from reading
+  // ahead, Windows has no cheap per range hint
+}
+#else // WIN32
+MappedFile::MappedFile(const std::filesystem::path &path)
+{
+  const auto file = open(path.c_str(), O_RDONLY);
+  if (file < 0)
+  {
+    throw std::runtime_error("Could not open " + path.string());
+  }
+
+  struct stat status = {};
+  if (fstat(file, &status) != 0)
+  {
+    close(file);
+    throw std::runtime_error("Could not get the size of " + path.string());
+  }
+  size_ = static_cast<std::size_t>(status.st_size);
+  if (size_ == 0)
+  {
+    close(file);
+    return;
+  }
+
+  auto *data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, file, 0);
+  // The mapping keeps the file alive
+  close(file);
+  if (data == MAP_FAILED)
+  {
+    throw std::runtime_error("Could not map " + path.string());
+  }
+  data_ = static_cast<const std::uint8_t *>(data);
+
+  madvise(data, size_, MADV_RANDOM);
+}
+
+MappedFile::~MappedFile()
+{
+  if (data_ != nullptr)
+  {
+    munmap(const_cast<std::uint8_t *>(data_), size_);
+  }
+}
+
+void MappedFile::prefetch(std::size_t offset, std::size_t size) const
+{
+  if (data_ == nullptr || offset >= size_)
+  {
+    return;
+  }
+
+  // madvise needs a page aligned address
+  static const auto page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  const auto        begin     = offset / page_size * page_size;
+  const auto        end       = std::min(offset + size, size_);
+  madvise(const_cast<std::uint8_t *>(data_) + begin,
+          end - begin,
+          MADV_WILLNEED);
+}
+#endif // WIN32
+
+ByteSpan MappedFile::bytes() const { return {data_, size_}; }
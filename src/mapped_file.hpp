@@ -0,0 +1,37 @@
+#pragma once
+
+#include "byte_span.hpp"
+
+#include <cstddef>
+#include <filesystem>
+
+// Read-only memory mapping of a whole file. Changes to the file within the
+// mapped size show up in the mapping, the file must be mapped again to see
+// data that was appended.
+class MappedFile
+{
+public:
+  // Throws std::runtime_error if the file cannot be mapped
+  explicit MappedFile(const std::filesystem::path &path);
+  ~MappedFile();
+
+  ByteSpan bytes() const;
+
+  // Hints the OS to read the range ahead of time. Without hints the pages
+  // are only read on access, since chunks are read in no particular order.
+  void prefetch(std::size_t offset, std::size_t size) const;
+
+private:
+  const std::uint8_t *data_ = nullptr;
+  std::size_t         size_ = 0;
+
+#ifdef WIN32
+  void *file_    = nullptr;
+  void *mapping_ = nullptr;
+#endif // WIN32
+
+  MappedFile(const MappedFile &)     = delete;
+  void operator=(const MappedFile &) = delete;
+  MappedFile(MappedFile &&)          = delete;
+  void operator=(MappedFile &&)      = delete;
+};
@@ -0,0 +1,188 @@
+#include "palette_block_storage.hpp"
+
+#include <algorithm>
+
+namespace
+{
+int bits_for_palette_size(std::size_t palette_size)
+{
+  if (palette_size <= 1)
+  {
+    return 0;
+  }
+  if (palette_size <= 2)
+  {
+    return 1;
+  }
+  if (palette_size <= 4)
+  {
+    return 2;
+  }
+  assert(palette_size <= 16);
+  return 4;
+}
+} // namespace
+
+PaletteBlockStorage::PaletteBlockStorage(int width, int height)
+    : width_{width},
+      height_{height}
+{
+  sections_.resize((height_ + section_height - 1) / section_height);
+  for (auto &section : sections_)
+  {
+    section.palette.push_back(Block::Type::Air);
+  }
+}
+
+int PaletteBlockStorage::width() const { return width_; }
+
+int PaletteBlockStorage::height() const { return height_; }
+
+std::size_t PaletteBlockStorage::size() const
+{
+  return static_cast<std::size_t>(width_) * width_ * height_;
+}
+
+std::size_t PaletteBlockStorage::section_volume() const
+{
+  return static_cast<std::size_t>(width_) * width_ * section_height;
+}
+
+void PaletteBlockStorage::set_palette_index(Section    &section,
+                                            std::size_t index,
+                                            unsigned    value)
+{
+  const auto bit   = index * section.bits_per_block;
+  const auto shift = bit % 64;
+  const auto mask  = ((std::uint64_t{1} << section.bits_per_block) - 1)
+                    << shift;
+  auto &word = section.indices[bit / 64];
+  word       = (word & ~mask) | ((std::uint64_t{value} << shift) & mask);
+}
+
+void PaletteBlockStorage::resize_indices(Section &section,
+                                         int      bits_per_block) const
+{
+  Section resized{};
+  resized.bits_per_block = bits_per_block;
+  resized.indices.resize((section_volume() * bits_per_block + 63) / 64);
+
+  for (std::size_t i = 0; i < section_volume(); ++i)
+  {
+    const auto value =
+        section.bits_per_block == 0 ? 0 : palette_index(section, i);
+    set_palette_index(resized, i, value);
+  }
+
+  section.bits_per_block = bits_per_block;
+  section.indices        = std::move(resized.indices);
+}
+
+void PaletteBlockStorage::set_type(int x, int y, int z, Block::Type type)
+{
+  assert(0 <= x && x < width_);
+  assert(0 <= y && y < height_);
+  assert(0 <= z && z < width_);
+
+  auto &section = sections_[y / section_height];
+  if (section.bits_per_block == 0 && section.palette[0] == type)
+  {
+    return;
+  }
+
+  auto iter = std::find(section.palette.begin(), section.palette.end(), type);
+  if (iter == section.palette.end())
+  {
+    section.palette.push_back(type);
+    iter = section.palette.end() - 1;
+
+    const auto bits_per_block = bits_for_palette_size(section.palette.size());
+    if (bits_per_block != section.bits_per_block)
+    {
+      resize_indices(section, bits_per_block);
+    }
+  }
+
+  set_palette_index(section,
+                    section_index(x, y, z),
+                    iter - section.palette.begin());
+}
+
+void PaletteBlockStorage::clear()
+{
+  for (auto &section : sections_)
+  {
+    section.bits_per_block = 0;
+    section.palette.assign(1, Block::Type::Air);
+    section.indices.clear();
+  }
+}
+
+void PaletteBlockStorage::release()
+{
+  clear();
+  for (auto &section : sections_)
+  {
+    decltype(section.indices){}.swap(section.indices);
+  }
+}
+
+void PaletteBlockStorage::compact()
+{
+  for (auto &section : sections_)
+  {
+    if (section.bits_per_block == 0)
+    {
+      continue;
+    }
+
+    // Find the palette entries that are still in use
+    std::vector<bool> is_used(section.palette.size(), false);
+    for (std::size_t i = 0; i < section_volume(); ++i)
+    {
+      is_used[palette_index(section, i)] = true;
+    }
+
+    std::vector<unsigned>    remap(section.palette.size(), 0);
+    std::vector<Block::Type> palette;
+    for (std::size_t i = 0; i < section.palette.size(); ++i)
+    {
+      if (is_used[i])
+      {
+        remap[i] = palette.size();
+        palette.push_back(section.palette[i]);
+      }
+    }
+
+    if (palette.size() == section.palette.size())
+    {
+      continue;
+    }
+
+    Section compacted{};
+    compacted.bits_per_block = bits_for_palette_size(palette.size());
+    compacted.indices.resize(
+        (section_volume() * compacted.bits_per_block + 63) / 64);
+    if (compacted.bits_per_block != 0)
+    {
+      for (std::size_t i = 0; i < section_volume(); ++i)
+      {
+        set_palette_index(compacted, i, remap[palette_index(section, i)]);
+      }
+    }
+    compacted.palette = std::move(palette);
+
+    section = std::move(compacted);
+  }
+}
+
+std::size_t PaletteBlockStorage::memory_usage() const
+{
+  auto bytes = sizeof(*this) + sections_.capacity() * sizeof(Section);
+  for (const auto &section : sections_)
+  {
+    bytes += section.palette.capacity() * sizeof(Block::Type);
+    bytes += section.indices.capacity() * sizeof(std::uint64_t);
+  }
+  return bytes;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "block.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Compressed storage for the blocks of one chunk.
+//
+// The chunk is split into vertical sections of section_height blocks. A
+// section that only contains one block type (e.g. all air above the terrain)
+// stores just that type. Every other section stores a palette of the block
+// types it contains and one bit packed palette index per block. The index
+// width (1, 2 or 4 bits) is chosen from the palette size and grows when a new
+// block type is placed into the section.
+class PaletteBlockStorage
+{
+public:
+  static constexpr int section_height = 16;
+
+  PaletteBlockStorage(int width, int height);
+
+  [[nodiscard]] int         width() const;
+  [[nodiscard]] int         height() const;
+  [[nodiscard]] std::size_t size() const;
+
+  [[nodiscard]] Block::Type type(int x, int y, int z) const;
+  void                      set_type(int x, int y, int z, Block::Type type);
+
+  // Makes every section uniform air again
+  void clear();
+
+  // Like clear(), but also frees the memory of the indices
+  void release();
+
+  // Rebuilds the palettes from the blocks that are actually used. Sections
+  // that ended up with a single block type become uniform again.
+  void compact();
+
+  [[nodiscard]] std::size_t memory_usage() const;
+
+private:
+  struct Section
+  {
+    // If bits_per_block is 0 the section is uniform and palette[0] is the
+    // type of every block in it
+    int                        bits_per_block{0};
+    std::vector<Block::Type>   palette;
+    std::vector<std::uint64_t> indices;
+  };
+
+  int width_{};
+  int height_{};
+
+  std::vector<Section> sections_;
+
+  [[nodiscard]] std::size_t section_volume() const;
+  [[nodiscard]] std::size_t section_index(int x, int y, int z) const;
+
+  [[nodiscard]] static unsigned
+  palette_index(const Section &section, std::size_t index);
+  static void
+  set_palette_index(Section &section, std::size_t index, unsigned value);
+
+  void resize_indices(Section &section, int bits_per_block) const;
+};
+
+inline std::size_t PaletteBlockStorage::section_index(int x, int y, int z) const
+{
+  return (static_cast<std::size_t>(x) * width_ + z) * section_height +
+         (y % section_height);
+}
+
+inline unsigned PaletteBlockStorage::palette_index(const Section &section,
+                                                   std::size_t    index)
+{
+  // Index widths are powers of two, so an index never spans two words
+  const auto bit  = index * section.bits_per_block;
+  const auto mask = (std::uint64_t{1} << section.bits_per_block) - 1;
+  return (section.indices[bit / 64] >> (bit % 64)) & mask;
+}
+
+inline Block::Type PaletteBlockStorage::type(int x, int y, int z) const
+{
+  assert(0 <= x && x < width_);
+  assert(0 <= y && y < height_);
+  assert(0 <= z && z < width_);
+
+  const auto &section = sections_[y / section_height];
+  if (section.bits_per_block == 0)
+  {
+    return section.palette[0];
+  }
+  return section.palette[palette_index(section, section_index(x, y, z))];
+}
@@ -4,31 +4,23 @@
 #include "debug_draw.hpp"
 #include "ray.hpp"
 
+#include <algorithm>
+
 namespace
 {
 }
 
 Player::Player() : camera_(glm::vec3(0.0f, 30.0f, 0.0f))
 {
-  auto       app    = Application::instance();
-  const auto config = app->config();
-
-  free_fly_        = config.config_value_bool("Player", "free_fly", free_fly_);
-  player_height_   = config.config_value_float("Player", "height", 1.3f);
-  gravity_         = config.config_value_float("Player", "gravity", 0.008f);
-  const auto speed = config.config_value_float("Player", "speed", 8.0f);
-
-  const auto start_position_x =
-      config.config_value_float("Player", "start_positon_x", 0.0f);
-  const auto start_position_y =
-      config.config_value_float("Player", "start_positon_y", 30.0f);
-  const auto start_position_z =
-      config.config_value_float("Player", "start_positon_z", 0.0f);
-
-  camera_.set_position(
-      glm::vec3{start_position_x, start_position_y, start_position_z});
+  const auto settings = Application::instance()->settings();
+
+  free_fly_      = settings->player.free_fly;
+  player_height_ = settings->player.height;
+  gravity_       = settings->player.gravity;
+
+  camera_.set_position(settings->player.start_position);
   camera_.set_free_fly(free_fly_);
-  camera_.set_movement_speed(speed);
+  camera_.set_movement_speed(settings->player.speed);
 }
 
 glm::mat4 Player::view_matrix() const { return camera_.view_matrix(); }
@@ -59,8 +51,16 @@ void Player::update(GLFWwindow *window,
     }
     else
     {
-      const auto is_block = world.is_block(
-          glm::ivec3{position.x, position.y - player_height_, position.z});
+      const glm::ivec3 feet_position{position.x,
+                                     position.y - player_height_,
+                                     position.z};
+      // Stand on the terrain surface while the chunk is not loaded yet, so
+      // the player does not fall through the world
+      const auto is_block =
+          world.is_block_loaded(feet_position)
+              ? world.is_block(feet_position)
+              : feet_position.y <=
+                    world.surface_height(feet_position.x, feet_position.z);
       if (!is_block)
       {
         position.y -= gravity_ * delta_time;
@@ -238,3 +238,18 @@ void Player::jump()
 }
 
 Camera Player::camera() const { return camera_; }
+
+void Player::spawn(const World &world)
+{
+  auto position = camera_.position();
+
+  // Terrain below the water level is covered with water
+  const auto water_level = world.water_level();
+  const auto ground =
+      std::max(static_cast<float>(world.surface_height(
+                   static_cast<int>(glm::floor(position.x)),
+                   static_cast<int>(glm::floor(position.z)))),
+               water_level);
+  position.y = ground + 1.0f + player_height_;
+  camera_.set_position(position);
+}
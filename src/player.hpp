@@ -21,6 +21,9 @@ public:
 
   Camera camera() const;
 
+  // Moves the player onto the terrain surface below the start position
+  void spawn(const World &world);
+
   void update(GLFWwindow *window,
               World      &world,
               DebugDraw  &debug_draw,
@@ -0,0 +1,369 @@
+#include "region_file.hpp"
+#include "log/log.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <stdexcept>
+
+#ifdef WIN32
+#include <Windows.h>
+#else // WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif // WIN32
+
+namespace
+{
+constexpr std::array<char, 4> magic{'V', 'X', 'R', 'G'};
+constexpr std::uint32_t       format_version = 1;
+
+// The table follows the magic and the version
+constexpr std::size_t table_offset = magic.size() + sizeof(std::uint32_t);
+constexpr std::size_t entry_size   = 2 * sizeof(std::uint32_t);
+constexpr std::size_t data_offset =
+    table_offset + RegionFile::region_size * RegionFile::region_size *
+                       entry_size;
+
+// Values are stored little endian, independent of the platform
+void write_u32(std::ostream &stream, std::uint32_t value)
+{
+  const std::array<char, 4> bytes{static_cast<char>(value & 0xff),
+                                  static_cast<char>((value >> 8) & 0xff),
+                                  static_cast<char>((value >> 16) & 0xff),
+                                  static_cast<char>((value >> 24) & 0xff)};
+  stream.write(bytes.data(), bytes.size());
+}
+
+std::uint32_t read_u32(std::istream &stream)
+{
+  std::array<unsigned char, 4> bytes{};
+  stream.read(reinterpret_cast<char *>(bytes.data()), bytes.size());
+  return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) |
+         (static_cast<std::uint32_t>(bytes[3]) << 24);
+}
+
+// Waits until the data the system buffers for the file is on disk. The
+// stream does not expose its handle, so the file is opened again.
+void sync_file(const std::filesystem::path &path)
+{
+#ifdef WIN32
+  const auto file = CreateFileW(path.c_str(),
+                                GENERIC_WRITE,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                nullptr,
+                                OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL,
+                                nullptr);
+  const auto is_synced =
+      file != INVALID_HANDLE_VALUE && FlushFileBuffers(file) != 0;
+  if (file != INVALID_HANDLE_VALUE)
+  {
+    CloseHandle(file);
+  }
+#else // WIN32
+  const auto file      = open(path.c_str(), O_RDWR);
+  const auto is_synced = file >= 0 && fsync(file) == 0;
+  if (file >= 0)
+  {
+    close(file);
+  }
+#endif // WIN32
+  if (!is_synced)
+  {
+    throw std::runtime_error("Could not sync " + path.string());
+  }
+}
+} // namespace
+
+RegionFile::RegionFile(const std::filesystem::path &path) : path_{path}
+{
+  if (!std::filesystem::exists(path_))
+  {
+    std::ofstream new_file{path_, std::ios::binary};
+    new_file.write(magic.data(), magic.size());
+    write_u32(new_file, format_version);
+    for (std::size_t i = 0; i < entry_count; ++i)
+    {
+      write_u32(new_file, 0);
+      write_u32(new_file, 0);
+    }
+    if (!new_file)
+    {
+      throw std::runtime_error("Could not create region file " +
+                               path_.string());
+    }
+  }
+
+  file_.open(path_, std::ios::in | std::ios::out | std::ios::binary);
+  if (!file_)
+  {
+    throw std::runtime_error("Could not open region file " + path_.string());
+  }
+
+  std::array<char, 4> file_magic{};
+  file_.read(file_magic.data(), file_magic.size());
+  const auto version = read_u32(file_);
+  for (auto &entry : entries_)
+  {
+    entry.offset = read_u32(file_);
+    entry.size   = read_u32(file_);
+  }
+  if (!file_ || file_magic != magic || version != format_version)
+  {
+    throw std::runtime_error(path_.string() + " is not a region file");
+  }
+
+  file_.seekg(0, std::ios::end);
+  end_ = static_cast<std::uint32_t>(file_.tellg());
+
+  // Everything between the chunks is free
+  std::vector<Entry> used_slots;
+  for (const auto &entry : entries_)
+  {
+    if (entry.size > 0)
+    {
+      used_slots.push_back(entry);
+    }
+  }
+  std::sort(used_slots.begin(),
+            used_slots.end(),
+            [](const Entry &a, const Entry &b) { return a.offset < b.offset; });
+  std::uint32_t free_begin = data_offset;
+  for (const auto &slot : used_slots)
+  {
+    if (slot.offset > free_begin)
+    {
+      free_slots_.push_back({free_begin, slot.offset - free_begin});
+    }
+    free_begin = std::max(free_begin, slot.offset + slot.size);
+  }
+  if (end_ > free_begin)
+  {
+    free_slots_.push_back({free_begin, end_ - free_begin});
+  }
+}
+
+RegionFile::~RegionFile()
+{
+  try
+  {
+    flush();
+  }
+  catch (const std::runtime_error &error)
+  {
+    LOG_ERROR() << error.what();
+  }
+}
+
+ByteSpan RegionFile::read(int x, int z)
+{
+  // Writes still in the stream buffer are not in the mapping yet
+  flush_stream();
+
+  const auto &entry = entries_[entry_index(x, z)];
+  if (entry.size == 0)
+  {
+    return {};
+  }
+
+  const auto end = std::size_t{entry.offset} + entry.size;
+  if (const auto *data = mapped_data(end))
+  {
+    return {data + entry.offset, entry.size};
+  }
+
+  read_buffer_.resize(entry.size);
+  file_.seekg(entry.offset);
+  file_.read(reinterpret_cast<char *>(read_buffer_.data()), entry.size);
+  if (!file_)
+  {
+    file_.clear();
+    throw std::runtime_error("Could not read chunk from " + path_.string());
+  }
+  return read_buffer_;
+}
+
+void RegionFile::write(int x, int z, const std::vector<std::uint8_t> &data)
+{
+  assert(!data.empty());
+
+  const auto index     = entry_index(x, z);
+  const auto size      = static_cast<std::uint32_t>(data.size());
+  const auto old_entry = entries_[index];
+
+  // The table on disk points to the data once it is synced in flush()
+  const auto offset = allocate(size);
+  file_.seekp(offset);
+  file_.write(reinterpret_cast<const char *>(data.data()), size);
+  entries_[index] = {offset, size};
+  if (std::find(pending_entries_.begin(), pending_entries_.end(), index) ==
+      pending_entries_.end())
+  {
+    pending_entries_.push_back(index);
+  }
+  is_dirty_ = true;
+  if (!file_)
+  {
+    file_.clear();
+    throw std::runtime_error("Could not write chunk to " + path_.string());
+  }
+
+  if (old_entry.size > 0)
+  {
+    released_slots_.push_back(old_entry);
+  }
+}
+
+void RegionFile::flush()
+{
+  if (pending_entries_.empty())
+  {
+    return;
+  }
+
+  // The data must be on disk before the table points to it, and the table
+  // before the slots it pointed to are written again
+  flush_stream();
+  sync_file(path_);
+  for (const auto index : pending_entries_)
+  {
+    write_entry(index);
+  }
+  is_dirty_ = true;
+  flush_stream();
+  sync_file(path_);
+  pending_entries_.clear();
+
+  for (const auto &slot : released_slots_)
+  {
+    release(slot);
+  }
+  released_slots_.clear();
+}
+
+void RegionFile::prefetch()
+{
+  flush_stream();
+  if (mapped_data(end_) != nullptr)
+  {
+    mapping_->prefetch(0, end_);
+  }
+}
+
+void RegionFile::flush_stream()
+{
+  if (!is_dirty_)
+  {
+    return;
+  }
+
+  file_.flush();
+  if (!file_)
+  {
+    file_.clear();
+    throw std::runtime_error("Could not write chunks to " + path_.string());
+  }
+  is_dirty_ = false;
+}
+
+std::size_t RegionFile::entry_index(int x, int z)
+{
+  assert(0 <= x && x < region_size);
+  assert(0 <= z && z < region_size);
+  return static_cast<std::size_t>(x) * region_size + z;
+}
+
+void RegionFile::write_entry(std::size_t index)
+{
+  file_.seekp(table_offset + index * entry_size);
+  write_u32(file_, entries_[index].offset);
+  write_u32(file_, entries_[index].size);
+}
+
+std::uint32_t RegionFile::allocate(std::uint32_t size)
+{
+  // First fit keeps the file short, as the slots near the table are used
+  // again first
+  const auto slot =
+      std::find_if(free_slots_.begin(),
+                   free_slots_.end(),
+                   [size](const Entry &free) { return free.size >= size; });
+  if (slot == free_slots_.end())
+  {
+    const auto offset = end_;
+    end_ += size;
+    return offset;
+  }
+
+  const auto offset = slot->offset;
+  slot->offset += size;
+  slot->size -= size;
+  if (slot->size == 0)
+  {
+    free_slots_.erase(slot);
+  }
+  return offset;
+}
+
+void RegionFile::release(const Entry &slot)
+{
+  // Merges the slot with the free slots right before and after it
+  auto next = std::lower_bound(free_slots_.begin(),
+                               free_slots_.end(),
+                               slot.offset,
+                               [](const Entry &free, std::uint32_t offset)
+                               { return free.offset < offset; });
+  if (next != free_slots_.begin())
+  {
+    const auto previous = std::prev(next);
+    if (previous->offset + previous->size == slot.offset)
+    {
+      previous->size += slot.size;
+      if (next != free_slots_.end() &&
+          previous->offset + previous->size == next->offset)
+      {
+        previous->size += next->size;
+        free_slots_.erase(next);
+      }
+      return;
+    }
+  }
+  if (next != free_slots_.end() && slot.offset + slot.size == next->offset)
+  {
+    next->offset = slot.offset;
+    next->size += slot.size;
+    return;
+  }
+  free_slots_.insert(next, slot);
+}
+
+const std::uint8_t *RegionFile::mapped_data(std::size_t end)
+{
+  if (!is_mapping_supported_)
+  {
+    return nullptr;
+  }
+
+  // Appended data is not part of an older mapping
+  if (!mapping_ || mapping_->bytes().size < end)
+  {
+    mapping_.reset();
+    try
+    {
+      mapping_ = std::make_unique<MappedFile>(path_);
+    }
+    catch (const std::runtime_error &error)
+    {
+      LOG_WARN() << error.what() << ", reading without memory mapping";
+      is_mapping_supported_ = false;
+      return nullptr;
+    }
+  }
+
+  if (mapping_->bytes().size < end)
+  {
+    throw std::runtime_error(path_.string() + " is truncated");
+  }
+  return mapping_->bytes().data;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "byte_span.hpp"
+#include "mapped_file.hpp"
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+// A file with the data of region_size x region_size chunks. It starts with a
+// table of offset and size for every chunk, followed by the chunk data.
+// Chunks are always written to a free slot, and the table on disk only
+// points to them once the data is synced, so a crash or power loss leaves the
+// old data readable. Slots of replaced data are reused once the new table is
+// synced, new data only goes to the end of the file if no free slot is big
+// enough. Reads go through a memory mapping of the file.
+class RegionFile
+{
+public:
+  static constexpr int region_size = 32;
+
+  // Creates the file if it does not exist. Throws std::runtime_error if it
+  // cannot be opened or is not a region file.
+  explicit RegionFile(const std::filesystem::path &path);
+  // Flushes the writes
+  ~RegionFile();
+
+  // x and z are relative to the region. Returns an empty span if the chunk
+  // was never written. The span is only valid until the next read or write.
+  ByteSpan read(int x, int z);
+  // Readable right away, on disk after the next flush()
+  void write(int x, int z, const std::vector<std::uint8_t> &data);
+  // Syncs the written chunks to disk, then the table entries that point to
+  // them. Throws std::runtime_error if the writes could not be completed.
+  void flush();
+
+  // Hints that chunks of this region will be read soon
+  void prefetch();
+
+private:
+  struct Entry
+  {
+    std::uint32_t offset;
+    std::uint32_t size;
+  };
+
+  static constexpr std::size_t entry_count = region_size * region_size;
+
+  std::filesystem::path          path_;
+  std::fstream                   file_;
+  std::array<Entry, entry_count> entries_{};
+  // Size of the file
+  std::uint32_t end_ = 0;
+
+  // Unused parts of the file, sorted by offset and never adjacent
+  std::vector<Entry> free_slots_;
+  // Slots of replaced data. The table on disk may still point to them, so
+  // they are only reused after the next flush.
+  std::vector<Entry> released_slots_;
+  // Entries that changed since the table was written
+  std::vector<std::size_t> pending_entries_;
+  // Whether the stream buffers writes the mapping does not see yet
+  bool is_dirty_ = false;
+
+  std::unique_ptr<MappedFile> mapping_{};
+  bool                        is_mapping_supported_ = true;
+  // Only used if the file cannot be mapped
+  std::vector<std::uint8_t> read_buffer_;
+
+  static std::size_t entry_index(int x, int z);
+
+  // Maps the file again if the mapping ends before end. Returns nullptr if
+  // the file cannot be mapped.
+  const std::uint8_t *mapped_data(std::size_t end);
+
+  void write_entry(std::size_t index);
+
+  // Hands the buffered writes to the system, they are not on disk yet
+  void flush_stream();
+
+  // Returns the offset of a free slot for size bytes
+  std::uint32_t allocate(std::uint32_t size);
+  void          release(const Entry &slot);
+};
@@ -0,0 +1,231 @@
+#include "region_storage.hpp"
+#include "chunk_codec.hpp"
+#include "log/log.hpp"
+#include "time.hpp"
+
+#include <future>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+// Rounds towards negative infinity, so chunk -1 is in region -1
+int floor_div(int value, int divisor)
+{
+  return value >= 0 ? value / divisor : (value - divisor + 1) / divisor;
+}
+} // namespace
+
+RegionStorage::RegionStorage(const std::filesystem::path &directory)
+    : directory_{directory}
+{
+  std::filesystem::create_directories(directory_);
+
+  // A single thread keeps loads and saves in order
+  io_thread_ = std::make_unique<ThreadPool>(1);
+
+  LOG_INFO() << "Storing chunks in " << directory_.string();
+}
+
+RegionStorage::~RegionStorage() { wait(); }
+
+void RegionStorage::load(const glm::ivec3 &chunk_position, LoadCallback done)
+{
+  const auto request_time = current_time_micros();
+  io_thread_->submit(
+      0.0f,
+      [this, chunk_position, done = std::move(done), request_time]()
+      {
+        ByteSpan data;
+        try
+        {
+          const auto [file, position] = region_file(chunk_position, false);
+          if (file != nullptr)
+          {
+            data = file->read(position.x, position.y);
+          }
+        }
+        catch (const std::runtime_error &error)
+        {
+          LOG_ERROR() << error.what();
+          data = {};
+        }
+
+        {
+          std::lock_guard<std::mutex> lock(statistics_mutex_);
+          if (data.empty())
+          {
+            ++statistics_.missing_count;
+          }
+          else
+          {
+            ++statistics_.loaded_count;
+            statistics_.load_latency += current_time_micros() - request_time;
+            statistics_.loaded_bytes += data.size;
+          }
+        }
+
+        done(data);
+
+        // Saves followed by loads are flushed once the loads are done
+        if (io_thread_->pending_count() <= 1)
+        {
+          flush();
+        }
+      });
+}
+
+std::vector<std::uint8_t>
+RegionStorage::load_now(const glm::ivec3 &chunk_position)
+{
+  std::promise<std::vector<std::uint8_t>> promise;
+  auto                                    data = promise.get_future();
+  load(chunk_position,
+       [&promise](ByteSpan loaded_data)
+       {
+         promise.set_value(std::vector<std::uint8_t>(
+             loaded_data.data, loaded_data.data + loaded_data.size));
+       });
+  return data.get();
+}
+
+void RegionStorage::save(const glm::ivec3        &chunk_position,
+                         const ChunkBlockStorage &blocks,
+                         bool                     is_decorated)
+{
+  // The chunk may be reused before the I/O thread gets to it
+  auto blocks_copy = std::make_shared<const ChunkBlockStorage>(blocks);
+  io_thread_->submit(0.0f,
+                     [this, chunk_position, blocks_copy, is_decorated]()
+                     {
+                       write(chunk_position,
+                             encode_chunk_blocks(*blocks_copy, is_decorated));
+                     });
+}
+
+void RegionStorage::save(const glm::ivec3         &chunk_position,
+                         std::vector<std::uint8_t> data)
+{
+  auto shared_data =
+      std::make_shared<const std::vector<std::uint8_t>>(std::move(data));
+  io_thread_->submit(0.0f,
+                     [this, chunk_position, shared_data]()
+                     { write(chunk_position, *shared_data); });
+}
+
+void RegionStorage::prefetch(const glm::ivec3 &chunk_position)
+{
+  const auto region = region_position(chunk_position);
+  if (is_region_prefetched_ && region == prefetched_region_)
+  {
+    return;
+  }
+  prefetched_region_    = region;
+  is_region_prefetched_ = true;
+
+  io_thread_->submit(0.0f,
+                     [this, chunk_position]()
+                     {
+                       try
+                       {
+                         const auto [file, position] =
+                             region_file(chunk_position, false);
+                         if (file == nullptr)
+                         {
+                           return;
+                         }
+                         file->prefetch();
+                       }
+                       catch (const std::runtime_error &error)
+                       {
+                         LOG_ERROR() << error.what();
+                         return;
+                       }
+
+                       std::lock_guard<std::mutex> lock(statistics_mutex_);
+                       ++statistics_.prefetch_count;
+                     });
+}
+
+void RegionStorage::wait() { io_thread_->wait(); }
+
+RegionStorage::Statistics RegionStorage::statistics() const
+{
+  std::lock_guard<std::mutex> lock(statistics_mutex_);
+  return statistics_;
+}
+
+void RegionStorage::write(const glm::ivec3               &chunk_position,
+                          const std::vector<std::uint8_t> &data)
+{
+  try
+  {
+    const auto [file, position] = region_file(chunk_position, true);
+    file->write(position.x, position.y, data);
+  }
+  catch (const std::runtime_error &error)
+  {
+    LOG_ERROR() << error.what();
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(statistics_mutex_);
+    ++statistics_.saved_count;
+    statistics_.saved_bytes += data.size();
+  }
+
+  // Chunks are saved in batches as they are unloaded, the files are synced
+  // once the last save of a batch is written. Only this job is pending then.
+  if (io_thread_->pending_count() <= 1)
+  {
+    flush();
+  }
+}
+
+void RegionStorage::flush()
+{
+  for (auto &[region, file] : region_files_)
+  {
+    try
+    {
+      file->flush();
+    }
+    catch (const std::runtime_error &error)
+    {
+      LOG_ERROR() << error.what();
+    }
+  }
+}
+
+std::pair<int, int>
+RegionStorage::region_position(const glm::ivec3 &chunk_position)
+{
+  return {floor_div(chunk_position.x, RegionFile::region_size),
+          floor_div(chunk_position.z, RegionFile::region_size)};
+}
+
+std::pair<RegionFile *, glm::ivec2>
+RegionStorage::region_file(const glm::ivec3 &chunk_position, bool create)
+{
+  const auto [region_x, region_z] = region_position(chunk_position);
+  const glm::ivec2 position{
+      chunk_position.x - region_x * RegionFile::region_size,
+      chunk_position.z - region_z * RegionFile::region_size};
+
+  auto it = region_files_.find({region_x, region_z});
+  if (it == region_files_.end())
+  {
+    const auto path = directory_ / ("r." + std::to_string(region_x) + "." +
+                                    std::to_string(region_z) + ".region");
+    if (!create && !std::filesystem::exists(path))
+    {
+      return {nullptr, position};
+    }
+    it = region_files_
+             .emplace(std::make_pair(region_x, region_z),
+                      std::make_unique<RegionFile>(path))
+             .first;
+  }
+  return {it->second.get(), position};
+}
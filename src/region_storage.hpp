@@ -0,0 +1,96 @@
+#pragma once
+
+#include "byte_span.hpp"
+#include "chunk.hpp"
+#include "math.hpp"
+#include "region_file.hpp"
+#include "thread_pool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Persists the blocks of chunks in region files below a directory. Files are
+// only touched by one background thread, which also encodes the chunks.
+// Loads and saves run in the order they were requested, so a chunk that is
+// loaded again right after it was saved gets the saved blocks.
+class RegionStorage
+{
+public:
+  struct Statistics
+  {
+    // Chunks that were found on disk and chunks that were not stored yet
+    int loaded_count;
+    int missing_count;
+    int saved_count;
+    // Microseconds from the load requests until the data was read
+    std::int64_t load_latency;
+    std::size_t  loaded_bytes;
+    std::size_t  saved_bytes;
+    // Regions that were read ahead of the player
+    int prefetch_count;
+  };
+
+  // Receives the stored data of a chunk, which is empty if the chunk was
+  // never saved. Called on the I/O thread, the data points into the mapped
+  // region file and is only valid during the call.
+  using LoadCallback = std::function<void(ByteSpan data)>;
+
+  explicit RegionStorage(const std::filesystem::path &directory);
+  // Finishes the queued saves
+  ~RegionStorage();
+
+  void load(const glm::ivec3 &chunk_position, LoadCallback done);
+  // Waits for the I/O thread and returns the data right away
+  std::vector<std::uint8_t> load_now(const glm::ivec3 &chunk_position);
+  void save(const glm::ivec3        &chunk_position,
+            const ChunkBlockStorage &blocks,
+            bool                     is_decorated);
+  // Saves data that was already encoded with encode_chunk_blocks()
+  void save(const glm::ivec3 &chunk_position, std::vector<std::uint8_t> data);
+
+  // Hints that the chunks of the region the chunk is in will be loaded soon.
+  // Only the first call for a region in a row does something. Must be
+  // called from the main thread.
+  void prefetch(const glm::ivec3 &chunk_position);
+
+  // Blocks until all queued loads and saves are done
+  void wait();
+
+  Statistics statistics() const;
+
+private:
+  std::filesystem::path directory_;
+
+  // Only touched on the main thread
+  std::pair<int, int> prefetched_region_{};
+  bool                is_region_prefetched_ = false;
+
+  // Only touched on the I/O thread
+  std::map<std::pair<int, int>, std::unique_ptr<RegionFile>> region_files_;
+
+  mutable std::mutex statistics_mutex_;
+  Statistics         statistics_{};
+
+  std::unique_ptr<ThreadPool> io_thread_;
+
+  // Writes encoded chunk data on the I/O thread
+  void write(const glm::ivec3               &chunk_position,
+             const std::vector<std::uint8_t> &data);
+  // Syncs the writes to all region files on the I/O thread
+  void flush();
+
+  static std::pair<int, int> region_position(const glm::ivec3 &chunk_position);
+
+  // Returns the file of the region the chunk is in and the position of the
+  // chunk within it. The file is nullptr if it does not exist and should not
+  // be created.
+  std::pair<RegionFile *, glm::ivec2>
+  region_file(const glm::ivec3 &chunk_position, bool create);
+};
@@ -0,0 +1,139 @@
+#include "settings.hpp"
+
+#include <utility>
+
+Settings Settings::from_config(const Config &config)
+{
+  Settings settings;
+
+  auto &chunk = settings.chunk;
+  chunk.water_level =
+      config.config_value_float("Chunk", "water_level", chunk.water_level);
+  chunk.water_speed =
+      config.config_value_float("Chunk", "water_speed", chunk.water_speed);
+
+  chunk.c1  = config.config_value_float("Chunk", "c1", chunk.c1);
+  chunk.c2  = config.config_value_float("Chunk", "c2", chunk.c2);
+  chunk.c3  = config.config_value_float("Chunk", "c3", chunk.c3);
+  chunk.div = config.config_value_float("Chunk", "div", chunk.div);
+  chunk.frequency1 =
+      config.config_value_float("Chunk", "frequency1", chunk.frequency1);
+  chunk.frequency2 =
+      config.config_value_float("Chunk", "frequency2", chunk.frequency2);
+  chunk.frequency3 =
+      config.config_value_float("Chunk", "frequency3", chunk.frequency3);
+  chunk.e = config.config_value_float("Chunk", "e", chunk.e);
+  chunk.fudge_factor =
+      config.config_value_float("Chunk", "fudge_factor", chunk.fudge_factor);
+  chunk.terraces =
+      config.config_value_float("Chunk", "terraces", chunk.terraces);
+
+  chunk.tree_density =
+      config.config_value_int("Chunk", "tree_density", chunk.tree_density);
+  chunk.min_tree_height = config.config_value_int("Chunk",
+                                                  "min_tree_height",
+                                                  chunk.min_tree_height);
+  chunk.max_tree_height = config.config_value_int("Chunk",
+                                                  "max_tree_height",
+                                                  chunk.max_tree_height);
+  chunk.min_leaves_radius = config.config_value_int("Chunk",
+                                                    "min_leaves_radius",
+                                                    chunk.min_leaves_radius);
+  chunk.max_leaves_radius = config.config_value_int("Chunk",
+                                                    "max_leaves_radius",
+                                                    chunk.max_leaves_radius);
+  chunk.leaves_density =
+      config.config_value_int("Chunk", "leaves_density", chunk.leaves_density);
+
+  const auto mesher = config.config_value_string("Chunk", "mesher", "naive");
+  if (mesher == "greedy")
+  {
+    chunk.mesher = ChunkSettings::Mesher::Greedy;
+  }
+  else if (mesher == "binary")
+  {
+    chunk.mesher = ChunkSettings::Mesher::Binary;
+  }
+  chunk.is_mesher_verified = config.config_value_bool("Chunk",
+                                                      "verify_mesher",
+                                                      chunk.is_mesher_verified);
+
+  auto &world = settings.world;
+  world.chunks_around_player = config.config_value_int(
+      "World", "chunks_around_player", world.chunks_around_player);
+  world.chunk_keep_radius = config.config_value_int(
+      "World", "chunk_keep_radius", world.chunks_around_player + 2);
+  world.max_loaded_chunks = config.config_value_int("World",
+                                                    "max_loaded_chunks",
+                                                    world.max_loaded_chunks);
+  world.cold_chunk_radius = config.config_value_int(
+      "World", "cold_chunk_radius", world.chunks_around_player + 2);
+
+  world.worker_count =
+      config.config_value_int("World", "worker_count", world.worker_count);
+  world.max_jobs_in_flight = config.config_value_int("World",
+                                                     "max_jobs_in_flight",
+                                                     world.max_jobs_in_flight);
+  world.view_weight =
+      config.config_value_float("World", "view_weight", world.view_weight);
+  world.upload_budget_ms = config.config_value_float("World",
+                                                     "upload_budget_ms",
+                                                     world.upload_budget_ms);
+  world.upload_budget_kib = config.config_value_int("World",
+                                                    "upload_budget_kib",
+                                                    world.upload_budget_kib);
+
+  world.save_directory = config.config_value_string("World",
+                                                    "save_directory",
+                                                    world.save_directory);
+  world.seed = static_cast<std::uint32_t>(
+      config.config_value_int("World", "seed", static_cast<int>(world.seed)));
+
+  world.debug_sun =
+      config.config_value_bool("World", "debug_sun", world.debug_sun);
+  world.fog_start =
+      config.config_value_float("World", "fog_start", world.fog_start);
+  world.fog_end = config.config_value_float("World", "fog_end", world.fog_end);
+  world.sky_color = glm::vec3{
+      config.config_value_float("World", "sky_color_r", world.sky_color.r),
+      config.config_value_float("World", "sky_color_g", world.sky_color.g),
+      config.config_value_float("World", "sky_color_b", world.sky_color.b)};
+
+  auto &player = settings.player;
+  player.free_fly =
+      config.config_value_bool("Player", "free_fly", player.free_fly);
+  player.height = config.config_value_float("Player", "height", player.height);
+  player.gravity =
+      config.config_value_float("Player", "gravity", player.gravity);
+  player.speed = config.config_value_float("Player", "speed", player.speed);
+  player.start_position = glm::vec3{
+      config.config_value_float("Player",
+                                "start_positon_x",
+                                player.start_position.x),
+      config.config_value_float("Player",
+                                "start_positon_y",
+                                player.start_position.y),
+      config.config_value_float("Player",
+                                "start_positon_z",
+                                player.start_position.z)};
+
+  return settings;
+}
+
+EventId SettingsChangedEvent::id = 0x5e7c4a1d;
+
+SettingsChangedEvent::SettingsChangedEvent(
+    std::shared_ptr<const Settings> old_settings,
+    std::shared_ptr<const Settings> settings)
+    : Event(id),
+      old_settings_{std::move(old_settings)},
+      settings_{std::move(settings)}
+{
+}
+
+const Settings &SettingsChangedEvent::old_settings() const
+{
+  return *old_settings_;
+}
+
+const Settings &SettingsChangedEvent::settings() const { return *settings_; }
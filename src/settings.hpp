@@ -0,0 +1,110 @@
+#pragma once
+
+#include "config.hpp"
+#include "event.hpp"
+#include "math.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Typed values of the config file, parsed once. Missing values keep the
+// defaults below. A snapshot never changes, a reload creates a new one.
+
+// [Chunk]
+struct ChunkSettings
+{
+  float water_level = 5.0f;
+  float water_speed = 0.03f;
+
+  // Terrain noise
+  float c1           = 1.0f;
+  float c2           = 0.7f;
+  float c3           = 0.008f;
+  float div          = 1.0f;
+  float frequency1   = 0.0003f;
+  float frequency2   = 0.008f;
+  float frequency3   = 0.1f;
+  float e            = 11.3f;
+  float fudge_factor = 1.1f;
+  float terraces     = 180.0f;
+
+  // Trees
+  int tree_density      = 6;
+  int min_tree_height   = 5;
+  int max_tree_height   = 11;
+  int min_leaves_radius = 3;
+  int max_leaves_radius = 5;
+  int leaves_density    = 2;
+
+  enum class Mesher
+  {
+    Naive,
+    Greedy,
+    Binary,
+  };
+  Mesher mesher             = Mesher::Naive;
+  bool   is_mesher_verified = false;
+};
+
+// [World]
+struct WorldSettings
+{
+  int chunks_around_player = 16;
+  // Default to chunks_around_player + 2
+  int chunk_keep_radius = 18;
+  int max_loaded_chunks = 1600;
+  int cold_chunk_radius = 18;
+
+  int   worker_count       = 0;
+  int   max_jobs_in_flight = 0;
+  float view_weight        = 1.0f;
+  float upload_budget_ms   = 2.0f;
+  int   upload_budget_kib  = 4096;
+
+  std::string   save_directory = "saves/world";
+  std::uint32_t seed           = 0;
+
+  bool      debug_sun = false;
+  float     fog_start = 200.0f;
+  float     fog_end   = 400.0f;
+  glm::vec3 sky_color{0.0f};
+};
+
+// [Player]
+struct PlayerSettings
+{
+  bool      free_fly = false;
+  float     height   = 1.3f;
+  float     gravity  = 0.008f;
+  float     speed    = 8.0f;
+  glm::vec3 start_position{0.0f, 30.0f, 0.0f};
+};
+
+struct Settings
+{
+  ChunkSettings  chunk;
+  WorldSettings  world;
+  PlayerSettings player;
+
+  static Settings from_config(const Config &config);
+};
+
+// Published after the config file changed and was loaded again. Most values
+// only apply to what is created afterwards, listeners pick up the ones they
+// can change on the fly.
+class SettingsChangedEvent : public Event
+{
+public:
+  static EventId id;
+
+  SettingsChangedEvent(std::shared_ptr<const Settings> old_settings,
+                       std::shared_ptr<const Settings> settings);
+
+  const Settings &old_settings() const;
+  const Settings &settings() const;
+
+private:
+  std::shared_ptr<const Settings> old_settings_;
+  std::shared_ptr<const Settings> settings_;
+};
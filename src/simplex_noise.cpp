@@ -0,0 +1,195 @@
+#include "simplex_noise.hpp"
+#include "log/log.hpp"
+#include "math.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#ifdef SIMPLEX_NOISE_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif // _MSC_VER
+
+// Each is compiled for its instruction set, see CMakeLists.txt
+void simplex_noise_2d_sse41(const float *x,
+                            const float *y,
+                            float       *noise,
+                            std::size_t  count);
+void simplex_noise_2d_avx2(const float *x,
+                           const float *y,
+                           float       *noise,
+                           std::size_t  count);
+void simplex_noise_2d_avx512(const float *x,
+                             const float *y,
+                             float       *noise,
+                             std::size_t  count);
+#endif // SIMPLEX_NOISE_X86
+
+namespace
+{
+// The kernels do the same operations as glm, so they only differ if the
+// compiler fused or reordered some of them in glm
+constexpr float max_error = 1e-5f;
+
+void simplex_noise_2d_scalar(const float *x,
+                             const float *y,
+                             float       *noise,
+                             std::size_t  count)
+{
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    noise[i] = glm::simplex(glm::vec2{x[i], y[i]});
+  }
+}
+
+#ifdef SIMPLEX_NOISE_X86
+enum class X86Feature
+{
+  Sse41,
+  Avx2,
+  Avx512f,
+};
+
+bool is_supported(X86Feature feature)
+{
+#ifdef _MSC_VER
+  std::array<int, 4> info{};
+  __cpuid(info.data(), 0);
+  const auto max_leaf = info[0];
+
+  __cpuid(info.data(), 1);
+  const bool has_sse41   = info[2] & (1 << 19);
+  const bool has_osxsave = info[2] & (1 << 27);
+  if (feature == X86Feature::Sse41)
+  {
+    return has_sse41;
+  }
+  if (!has_osxsave || max_leaf < 7)
+  {
+    return false;
+  }
+
+  // The operating system must save the wider registers too
+  const auto enabled_state = _xgetbv(0);
+  __cpuidex(info.data(), 7, 0);
+  if (feature == X86Feature::Avx2)
+  {
+    return (enabled_state & 0x06) == 0x06 && (info[1] & (1 << 5));
+  }
+  return (enabled_state & 0xe6) == 0xe6 && (info[1] & (1 << 16));
+#else  // _MSC_VER
+  __builtin_cpu_init();
+  switch (feature)
+  {
+  case X86Feature::Sse41:
+    return __builtin_cpu_supports("sse4.1");
+  case X86Feature::Avx2:
+    return __builtin_cpu_supports("avx2");
+  case X86Feature::Avx512f:
+    return __builtin_cpu_supports("avx512f");
+  }
+  return false;
+#endif // _MSC_VER
+}
+#endif // SIMPLEX_NOISE_X86
+
+// Points in the range terrain generation samples, including the blue noise
+// at 50 times the block frequency
+void sample_points(std::vector<float> &x, std::vector<float> &y, int count)
+{
+  std::mt19937                          rng(1);
+  std::uniform_real_distribution<float> position(-500000.0f, 500000.0f);
+  std::uniform_real_distribution<float> near_position(-100.0f, 100.0f);
+
+  x.resize(count);
+  y.resize(count);
+  for (int i = 0; i < count; ++i)
+  {
+    auto &distribution = i % 2 == 0 ? position : near_position;
+    x[i]               = distribution(rng);
+    y[i]               = distribution(rng);
+  }
+}
+
+float error(SimplexNoiseKernel::Function function,
+            const std::vector<float>   &x,
+            const std::vector<float>   &y)
+{
+  std::vector<float> noise(x.size());
+  std::vector<float> expected(x.size());
+  function(x.data(), y.data(), noise.data(), x.size());
+  simplex_noise_2d_scalar(x.data(), y.data(), expected.data(), x.size());
+
+  float max = 0.0f;
+  for (std::size_t i = 0; i < x.size(); ++i)
+  {
+    max = std::max(max, std::abs(noise[i] - expected[i]));
+  }
+  return max;
+}
+
+const SimplexNoiseKernel &selected_instruction_set()
+{
+  static const SimplexNoiseKernel selected = []
+  {
+    std::vector<float> x;
+    std::vector<float> y;
+    sample_points(x, y, 4099);
+
+    const auto kernels = simplex_noise_kernels();
+    for (const auto &kernel : kernels)
+    {
+      if (!kernel.is_supported)
+      {
+        continue;
+      }
+
+      const auto kernel_error = error(kernel.function, x, y);
+      if (kernel_error > max_error)
+      {
+        LOG_WARN() << kernel.name << " simplex noise differs from glm by "
+                   << kernel_error << ", not using it";
+        continue;
+      }
+
+      LOG_INFO() << "Simplex noise uses " << kernel.name << " (difference to "
+                 << "glm " << kernel_error << ")";
+      return kernel;
+    }
+    return kernels.back();
+  }();
+  return selected;
+}
+} // namespace
+
+void simplex_noise_2d(const float *x,
+                      const float *y,
+                      float       *noise,
+                      std::size_t  count)
+{
+  selected_instruction_set().function(x, y, noise, count);
+}
+
+const char *simplex_noise_instruction_set()
+{
+  return selected_instruction_set().name;
+}
+
+std::vector<SimplexNoiseKernel> simplex_noise_kernels()
+{
+  std::vector<SimplexNoiseKernel> kernels;
+#ifdef SIMPLEX_NOISE_X86
+  kernels.push_back({"AVX-512",
+                     simplex_noise_2d_avx512,
+                     is_supported(X86Feature::Avx512f)});
+  kernels.push_back(
+      {"AVX2", simplex_noise_2d_avx2, is_supported(X86Feature::Avx2)});
+  kernels.push_back(
+      {"SSE4.1", simplex_noise_2d_sse41, is_supported(X86Feature::Sse41)});
+#endif // SIMPLEX_NOISE_X86
+  kernels.push_back({"scalar", simplex_noise_2d_scalar, true});
+  return kernels;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Evaluates glm::simplex(glm::vec2{x[i], y[i]}) for count points at once.
+// Uses the widest SIMD instruction set the CPU supports (AVX-512, AVX2 or
+// SSE4.1) that gives the same results as glm, and glm itself otherwise.
+void simplex_noise_2d(const float *x,
+                      const float *y,
+                      float       *noise,
+                      std::size_t  count);
+
+// Name of the instruction set simplex_noise_2d() uses
+const char *simplex_noise_instruction_set();
+
+// An implementation of simplex_noise_2d() for one instruction set
+struct SimplexNoiseKernel
+{
+  using Function = void (*)(const float *x,
+                            const float *y,
+                            float       *noise,
+                            std::size_t  count);
+
+  const char *name;
+  Function    function;
+  // Whether the CPU can run it
+  bool is_supported;
+};
+
+// All kernels built into the program, widest first. The last one calls glm
+// and is always supported.
+std::vector<SimplexNoiseKernel> simplex_noise_kernels();
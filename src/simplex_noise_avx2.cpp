@@ -0,0 +1,46 @@
+#include "simplex_noise_kernel.hpp"
+
+#include <immintrin.h>
+
+namespace
+{
+struct Avx2Floats
+{
+  using Type = __m256;
+
+  static constexpr std::size_t width = 8;
+
+  static Type load(const float *p) { return _mm256_loadu_ps(p); }
+  static void store(float *p, Type v) { _mm256_storeu_ps(p, v); }
+  static Type set(float v) { return _mm256_set1_ps(v); }
+
+  static Type add(Type a, Type b) { return _mm256_add_ps(a, b); }
+  static Type sub(Type a, Type b) { return _mm256_sub_ps(a, b); }
+  static Type mul(Type a, Type b) { return _mm256_mul_ps(a, b); }
+  static Type div(Type a, Type b) { return _mm256_div_ps(a, b); }
+  static Type max(Type a, Type b) { return _mm256_max_ps(a, b); }
+
+  static Type floor(Type v) { return _mm256_floor_ps(v); }
+  static Type fract(Type v) { return sub(v, floor(v)); }
+  static Type abs(Type v)
+  {
+    return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), v);
+  }
+
+  // a > b ? if_greater : otherwise
+  static Type select_greater(Type a, Type b, Type if_greater, Type otherwise)
+  {
+    return _mm256_blendv_ps(otherwise,
+                            if_greater,
+                            _mm256_cmp_ps(a, b, _CMP_GT_OQ));
+  }
+};
+} // namespace
+
+void simplex_noise_2d_avx2(const float *x,
+                           const float *y,
+                           float       *noise,
+                           std::size_t  count)
+{
+  simplex_noise_2d_kernel<Avx2Floats>(x, y, noise, count);
+}
@@ -0,0 +1,46 @@
+#include "simplex_noise_kernel.hpp"
+
+#include <immintrin.h>
+
+namespace
+{
+struct Avx512Floats
+{
+  using Type = __m512;
+
+  static constexpr std::size_t width = 16;
+
+  static Type load(const float *p) { return _mm512_loadu_ps(p); }
+  static void store(float *p, Type v) { _mm512_storeu_ps(p, v); }
+  static Type set(float v) { return _mm512_set1_ps(v); }
+
+  static Type add(Type a, Type b) { return _mm512_add_ps(a, b); }
+  static Type sub(Type a, Type b) { return _mm512_sub_ps(a, b); }
+  static Type mul(Type a, Type b) { return _mm512_mul_ps(a, b); }
+  static Type div(Type a, Type b) { return _mm512_div_ps(a, b); }
+  static Type max(Type a, Type b) { return _mm512_max_ps(a, b); }
+
+  static Type floor(Type v)
+  {
+    return _mm512_roundscale_ps(v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+  }
+  static Type fract(Type v) { return sub(v, floor(v)); }
+  static Type abs(Type v) { return _mm512_abs_ps(v); }
+
+  // a > b ? if_greater : otherwise
+  static Type select_greater(Type a, Type b, Type if_greater, Type otherwise)
+  {
+    return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(a, b, _CMP_GT_OQ),
+                                otherwise,
+                                if_greater);
+  }
+};
+} // namespace
+
+void simplex_noise_2d_avx512(const float *x,
+                             const float *y,
+                             float       *noise,
+                             std::size_t  count)
+{
+  simplex_noise_2d_kernel<Avx512Floats>(x, y, noise, count);
+}
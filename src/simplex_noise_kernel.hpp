@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+
+// 2D simplex noise for several points at once, written against a vector
+// type that provides the operations below. Every operation matches one in
+// glm::simplex(vec2), in the same order, so the results are the same.
+//
+// Included by the instruction set specific files, which are compiled with
+// different flags. Only code from this header and the intrinsics may be used
+// there, inline functions from other headers could end up in the rest of the
+// program.
+template <typename Floats>
+void simplex_noise_2d_kernel(const float *x,
+                             const float *y,
+                             float       *noise,
+                             std::size_t  count)
+{
+  using F = Floats;
+
+  const auto c_x = F::set(0.211324865405187f);
+  const auto c_y = F::set(0.366025403784439f);
+  const auto c_z = F::set(-0.577350269189626f);
+  const auto c_w = F::set(0.024390243902439f);
+
+  const auto zero  = F::set(0.0f);
+  const auto half  = F::set(0.5f);
+  const auto one   = F::set(1.0f);
+  const auto two   = F::set(2.0f);
+  const auto m_289 = F::set(289.0f);
+
+  const auto mod289 = [&](typename F::Type v)
+  {
+    return F::sub(v,
+                  F::mul(F::floor(F::mul(v, F::set(1.0f / 289.0f))), m_289));
+  };
+  const auto permute = [&](typename F::Type v)
+  { return mod289(F::mul(F::add(F::mul(v, F::set(34.0f)), one), v)); };
+
+  const auto evaluate = [&](typename F::Type v_x, typename F::Type v_y)
+  {
+    // First corner
+    const auto d   = F::add(F::mul(v_x, c_y), F::mul(v_y, c_y));
+    auto       i_x = F::floor(F::add(v_x, d));
+    auto       i_y = F::floor(F::add(v_y, d));
+
+    const auto d_i  = F::add(F::mul(i_x, c_x), F::mul(i_y, c_x));
+    const auto x0_x = F::add(F::sub(v_x, i_x), d_i);
+    const auto x0_y = F::add(F::sub(v_y, i_y), d_i);
+
+    // Other corners
+    const auto i1_x = F::select_greater(x0_x, x0_y, one, zero);
+    const auto i1_y = F::select_greater(x0_x, x0_y, zero, one);
+
+    const auto x12_x = F::sub(F::add(x0_x, c_x), i1_x);
+    const auto x12_y = F::sub(F::add(x0_y, c_x), i1_y);
+    const auto x12_z = F::add(x0_x, c_z);
+    const auto x12_w = F::add(x0_y, c_z);
+
+    // Permutations
+    i_x = F::sub(i_x, F::mul(m_289, F::floor(F::div(i_x, m_289))));
+    i_y = F::sub(i_y, F::mul(m_289, F::floor(F::div(i_y, m_289))));
+
+    const auto p0 =
+        permute(F::add(F::add(permute(F::add(i_y, zero)), i_x), zero));
+    const auto p1 =
+        permute(F::add(F::add(permute(F::add(i_y, i1_y)), i_x), i1_x));
+    const auto p2 =
+        permute(F::add(F::add(permute(F::add(i_y, one)), i_x), one));
+
+    const auto falloff = [&](typename F::Type a, typename F::Type b)
+    {
+      auto m = F::max(F::sub(half, F::add(F::mul(a, a), F::mul(b, b))), zero);
+      m      = F::mul(m, m);
+      return F::mul(m, m);
+    };
+
+    // Gradients are 41 points on a line, mapped onto a diamond
+    const auto gradient = [&](typename F::Type p,
+                              typename F::Type m,
+                              typename F::Type a,
+                              typename F::Type b)
+    {
+      const auto g_x = F::sub(F::mul(two, F::fract(F::mul(p, c_w))), one);
+      const auto h   = F::sub(F::abs(g_x), half);
+      const auto a0  = F::sub(g_x, F::floor(F::add(g_x, half)));
+
+      m = F::mul(m,
+                 F::sub(F::set(1.79284291400159f),
+                        F::mul(F::set(0.85373472095314f),
+                               F::add(F::mul(a0, a0), F::mul(h, h)))));
+      return F::mul(m, F::add(F::mul(a0, a), F::mul(h, b)));
+    };
+
+    const auto n0 = gradient(p0, falloff(x0_x, x0_y), x0_x, x0_y);
+    const auto n1 = gradient(p1, falloff(x12_x, x12_y), x12_x, x12_y);
+    const auto n2 = gradient(p2, falloff(x12_z, x12_w), x12_z, x12_w);
+    return F::mul(F::set(130.0f), F::add(F::add(n0, n1), n2));
+  };
+
+  std::size_t i = 0;
+  for (; i + F::width <= count; i += F::width)
+  {
+    F::store(noise + i, evaluate(F::load(x + i), F::load(y + i)));
+  }
+
+  // The rest is padded to a full vector
+  if (i < count)
+  {
+    float rest_x[F::width]{};
+    float rest_y[F::width]{};
+    float rest_noise[F::width]{};
+    for (std::size_t j = 0; i + j < count; ++j)
+    {
+      rest_x[j] = x[i + j];
+      rest_y[j] = y[i + j];
+    }
+    F::store(rest_noise, evaluate(F::load(rest_x), F::load(rest_y)));
+    for (std::size_t j = 0; i + j < count; ++j)
+    {
+      noise[i + j] = rest_noise[j];
+    }
+  }
+}
@@ -0,0 +1,41 @@
+#include "simplex_noise_kernel.hpp"
+
+#include <immintrin.h>
+
+namespace
+{
+struct Sse41Floats
+{
+  using Type = __m128;
+
+  static constexpr std::size_t width = 4;
+
+  static Type load(const float *p) { return _mm_loadu_ps(p); }
+  static void store(float *p, Type v) { _mm_storeu_ps(p, v); }
+  static Type set(float v) { return _mm_set1_ps(v); }
+
+  static Type add(Type a, Type b) { return _mm_add_ps(a, b); }
+  static Type sub(Type a, Type b) { return _mm_sub_ps(a, b); }
+  static Type mul(Type a, Type b) { return _mm_mul_ps(a, b); }
+  static Type div(Type a, Type b) { return _mm_div_ps(a, b); }
+  static Type max(Type a, Type b) { return _mm_max_ps(a, b); }
+
+  static Type floor(Type v) { return _mm_floor_ps(v); }
+  static Type fract(Type v) { return sub(v, floor(v)); }
+  static Type abs(Type v) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), v); }
+
+  // a > b ? if_greater : otherwise
+  static Type select_greater(Type a, Type b, Type if_greater, Type otherwise)
+  {
+    return _mm_blendv_ps(otherwise, if_greater, _mm_cmpgt_ps(a, b));
+  }
+};
+} // namespace
+
+void simplex_noise_2d_sse41(const float *x,
+                            const float *y,
+                            float       *noise,
+                            std::size_t  count)
+{
+  simplex_noise_2d_kernel<Sse41Floats>(x, y, noise, count);
+}
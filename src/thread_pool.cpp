@@ -0,0 +1,102 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <utility>
+
+bool ThreadPool::QueuedJob::operator<(const QueuedJob &other) const
+{
+  // std::priority_queue pops the largest element first
+  if (priority != other.priority)
+  {
+    return priority > other.priority;
+  }
+  return sequence > other.sequence;
+}
+
+ThreadPool::ThreadPool(int worker_count)
+{
+  if (worker_count <= 0)
+  {
+    const auto hardware_threads =
+        static_cast<int>(std::thread::hardware_concurrency());
+    worker_count = std::max(1, hardware_threads - 1);
+  }
+
+  for (int i = 0; i < worker_count; ++i)
+  {
+    workers_.emplace_back(&ThreadPool::work, this);
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_stopping_ = true;
+    jobs_        = {};
+  }
+  condition_.notify_all();
+
+  for (auto &worker : workers_)
+  {
+    worker.join();
+  }
+}
+
+void ThreadPool::submit(float priority, Job job)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.push({priority, next_sequence_++, std::move(job)});
+  }
+  condition_.notify_one();
+}
+
+void ThreadPool::clear()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  jobs_ = {};
+}
+
+void ThreadPool::wait()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_condition_.wait(lock,
+                       [this] { return jobs_.empty() && running_count_ == 0; });
+}
+
+int ThreadPool::worker_count() const { return workers_.size(); }
+
+int ThreadPool::pending_count() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return jobs_.size() + running_count_;
+}
+
+void ThreadPool::work()
+{
+  while (true)
+  {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [this] { return is_stopping_ || !jobs_.empty(); });
+      if (is_stopping_)
+      {
+        return;
+      }
+      job = std::move(jobs_.top().job);
+      jobs_.pop();
+      ++running_count_;
+    }
+
+    job();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    --running_count_;
+    if (jobs_.empty() && running_count_ == 0)
+    {
+      idle_condition_.notify_all();
+    }
+  }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+using Job = std::function<void()>;
+
+// Runs jobs on a fixed number of worker threads. Jobs with a lower priority
+// value run first.
+class ThreadPool
+{
+public:
+  // A worker count of 0 uses one worker less than there are hardware threads
+  explicit ThreadPool(int worker_count = 0);
+  ~ThreadPool();
+
+  void submit(float priority, Job job);
+
+  // Drops all jobs that did not start yet
+  void clear();
+
+  // Blocks until all queued jobs are done
+  void wait();
+
+  int worker_count() const;
+
+  // Jobs that are queued or running
+  int pending_count() const;
+
+private:
+  struct QueuedJob
+  {
+    float priority;
+    // Keeps jobs of equal priority in submission order
+    std::uint64_t sequence;
+    // Moved out of the top of the queue, it does not take part in the order
+    mutable Job job;
+
+    bool operator<(const QueuedJob &other) const;
+  };
+
+  std::vector<std::thread> workers_;
+
+  mutable std::mutex             mutex_;
+  std::condition_variable        condition_;
+  std::condition_variable        idle_condition_;
+  std::priority_queue<QueuedJob> jobs_;
+  std::uint64_t                  next_sequence_ = 0;
+  int                            running_count_ = 0;
+  bool                           is_stopping_   = false;
+
+  void work();
+
+  ThreadPool(const ThreadPool &) = delete;
+  void operator=(const ThreadPool &) = delete;
+  ThreadPool(ThreadPool &&)          = delete;
+  void operator=(ThreadPool &&) = delete;
+};
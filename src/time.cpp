@@ -1,5 +1,7 @@
 #include "time.hpp"
 
+#include <chrono>
+
 #ifdef WIN32
 #include <Windows.h>
 #else // WIN32
@@ -18,3 +20,9 @@ std::int64_t current_time_millis()
   return ret;
 #endif // WIN32
 }
+
+std::int64_t current_time_micros()
+{
+  const auto now = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+}
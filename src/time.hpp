@@ -3,3 +3,5 @@
 #include <cstdint>
 
 std::int64_t current_time_millis();
+
+std::int64_t current_time_micros();
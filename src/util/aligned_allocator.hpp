@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+// Allocator for standard containers that places the first element on an
+// Alignment byte boundary, e.g. on a cache line.
+template <typename T, std::size_t Alignment> class AlignedAllocator
+{
+public:
+  static_assert(Alignment >= alignof(T), "Alignment is too small for T");
+  static_assert((Alignment & (Alignment - 1)) == 0,
+                "Alignment must be a power of two");
+
+  using value_type = T;
+
+  template <typename U> struct rebind
+  {
+    using other = AlignedAllocator<U, Alignment>;
+  };
+
+  AlignedAllocator() noexcept = default;
+
+  template <typename U>
+  AlignedAllocator(const AlignedAllocator<U, Alignment> & /*other*/) noexcept
+  {
+  }
+
+  T *allocate(std::size_t count)
+  {
+    return static_cast<T *>(
+        ::operator new(count * sizeof(T), std::align_val_t{Alignment}));
+  }
+
+  void deallocate(T *pointer, std::size_t /*count*/) noexcept
+  {
+    ::operator delete(pointer, std::align_val_t{Alignment});
+  }
+
+  template <typename U>
+  bool operator==(const AlignedAllocator<U, Alignment> & /*other*/) const
+  {
+    return true;
+  }
+
+  template <typename U>
+  bool operator!=(const AlignedAllocator<U, Alignment> & /*other*/) const
+  {
+    return false;
+  }
+};
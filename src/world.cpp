@@ -4,6 +4,8 @@
 #include "block.hpp"
 #include "camera.hpp"
 #include "chunk.hpp"
+#include "chunk_mesher.hpp"
+#include "chunk_streamer.hpp"
 #include "debug_draw.hpp"
 #include "defer.hpp"
 #include "gl/gl_framebuffer.hpp"
@@ -11,12 +13,16 @@
 #include "gl/gl_texture_array.hpp"
 #include "gui_texture.hpp"
 #include "image.hpp"
+#include "log/log.hpp"
+#include "time.hpp"
 
 #include <FastDelegate.h>
 #include <stb_image.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <cstdlib>
 #include <filesystem>
 #include <memory>
 
@@ -46,47 +52,6 @@ player_position_to_world_block_position(const glm::vec3 &player_position)
   return block_position;
 }
 
-std::pair<glm::ivec3, glm::ivec3>
-world_position_to_chunk_position(const glm::ivec3 &world_position)
-{
-  glm::ivec3 chunk_position{world_position.x / Chunk::width(),
-                            world_position.y / Chunk::height(),
-                            world_position.z / Chunk::width()};
-
-  glm::ivec3 block_position{
-      world_position.x - chunk_position.x * Chunk::width(),
-      world_position.y - chunk_position.y * Chunk::height(),
-      world_position.z - chunk_position.z * Chunk::width()};
-
-  if (block_position.x < 0)
-  {
-    block_position.x += Chunk::width();
-  }
-  if (block_position.y < 0)
-  {
-    block_position.y += Chunk::height();
-  }
-  if (block_position.z < 0)
-  {
-    block_position.z += Chunk::width();
-  }
-
-  if (world_position.x < 0 && world_position.x % Chunk::width() != 0)
-  {
-    chunk_position.x -= 1;
-  }
-  if (world_position.y < 0 && world_position.y % Chunk::height() != 0)
-  {
-    chunk_position.y -= 1;
-  }
-  if (world_position.z < 0 && world_position.z % Chunk::width() != 0)
-  {
-    chunk_position.z -= 1;
-  }
-
-  return {chunk_position, block_position};
-}
-
 glm::ivec3 position_to_chunk_position(const glm::vec3 &position)
 {
   const auto block_position = player_position_to_world_block_position(position);
@@ -100,50 +65,78 @@ glm::ivec3 position_to_chunk_position(const glm::vec3 &position)
 
 World::World()
 {
-  const auto app    = Application::instance();
-  const auto config = app->config();
-  grid_size_        = config.config_value_int("World", "grid_size", grid_size_);
-  chunks_around_player_ = config.config_value_int("World",
-                                                  "chunks_around_player",
-                                                  chunks_around_player_);
-  debug_sun_ = config.config_value_bool("World", "debug_sun", debug_sun_);
-
-  fog_start_ = config.config_value_float("World", "fog_start", fog_start_);
-  fog_end_   = config.config_value_float("World", "fog_end", fog_end_);
-  const auto fog_color_r =
-      config.config_value_float("World", "sky_color_r", 0.0f);
-  const auto fog_color_g =
-      config.config_value_float("World", "sky_color_g", 0.0f);
-  const auto fog_color_b =
-      config.config_value_float("World", "sky_color_b", 0.0f);
-  fog_color_ = glm::vec3{fog_color_r, fog_color_g, fog_color_b};
-
-  water_level_ =
-      config.config_value_float("Chunk", "water_level", water_level_);
-  water_speed_ =
-      config.config_value_float("Chunk", "water_speed", water_speed_);
+  const auto app      = Application::instance();
+  const auto settings = app->settings();
+  apply_settings(*settings);
+
+  water_level_ = settings->chunk.water_level;
+
+  heightmaps_ = std::make_unique<HeightmapCache>();
+  region_storage_ =
+      std::make_unique<RegionStorage>(settings->world.save_directory);
+  chunk_streamer_ = std::make_unique<ChunkStreamer>(*this);
+
+  // Chunks the streamer still needs must stay loaded, including the ring of
+  // chunks around the streamed square that trees can grow into
+  const auto chunks_around_player = chunk_streamer_->chunks_around_player();
+  chunk_keep_radius_              = settings->world.chunk_keep_radius;
+  if (chunk_keep_radius_ <= chunks_around_player)
+  {
+    LOG_WARN() << "chunk_keep_radius " << chunk_keep_radius_
+               << " is too small, using " << chunks_around_player + 1;
+    chunk_keep_radius_ = chunks_around_player + 1;
+  }
+  max_loaded_chunks_ = settings->world.max_loaded_chunks;
+
+  // Chunks next to the streamed square are meshed with it, so they need
+  // their blocks
+  cold_chunk_radius_ = settings->world.cold_chunk_radius;
+  if (cold_chunk_radius_ != 0 && cold_chunk_radius_ <= chunks_around_player)
+  {
+    LOG_WARN() << "cold_chunk_radius " << cold_chunk_radius_
+               << " is too small, using " << chunks_around_player + 1;
+    cold_chunk_radius_ = chunks_around_player + 1;
+  }
 
   app->event_manager()->subscribe(
       MakeDelegate(this, &World::on_window_resize_event),
       WindowResizeEvent::id);
+  app->event_manager()->subscribe(
+      MakeDelegate(this, &World::on_settings_changed_event),
+      SettingsChangedEvent::id);
 }
 
 World::~World()
 {
+  // Loads report to the streamer and jobs reference the chunks, so stop
+  // streaming first
+  region_storage_->wait();
+  chunk_streamer_.reset();
+
+  std::size_t saved_count = 0;
+  for (auto &[position, loaded_chunk] : chunks_)
+  {
+    auto &c = *loaded_chunk.chunk;
+    if (c.is_generated() && c.is_modified())
+    {
+      save_chunk(c);
+      ++saved_count;
+    }
+  }
+  LOG_INFO() << "Saving " << saved_count << " chunks";
+  region_storage_.reset();
+
   const auto app = Application::instance();
   app->event_manager()->unsubscribe(
       MakeDelegate(this, &World::on_window_resize_event),
       WindowResizeEvent::id);
+  app->event_manager()->unsubscribe(
+      MakeDelegate(this, &World::on_settings_changed_event),
+      SettingsChangedEvent::id);
 }
 
 void World::init()
 {
-  chunks_.resize(grid_size_);
-  for (std::size_t i = 0; i < chunks_.size(); ++i)
-  {
-    chunks_[i].resize(grid_size_);
-  }
-
   const Image grass_top_image{"data/grass_top.png"};
   assert(grass_top_image.channels_count() == 4);
 
@@ -167,7 +160,7 @@ void World::init()
 
   block_textures_ = std::make_unique<GlTextureArray>();
   block_textures_->set_data({
-      // Order must match block_texture_index()
+      // Order must match the texture layers in block_properties
       {
           grass_top_image.data(),
           grass_top_image.width(),
@@ -217,150 +210,245 @@ void World::init()
   recreate_framebuffer();
 }
 
-int World::block_texture_index(Block::Type block_type,
-                               Block::Side block_side) const
+void World::set_player_position(const glm::vec3 &position,
+                                const glm::vec3 &view_direction)
 {
-  switch (block_type)
-  {
-  case Block::Type::Grass:
+  player_position_ = position;
+
+  const auto player_chunk_position = position_to_chunk_position(position);
+  compress_cold_chunks(player_chunk_position);
+  const auto upload_count =
+      chunk_streamer_->update(player_chunk_position, view_direction);
+  unload_chunks(player_chunk_position);
+  if (upload_count > 0)
   {
-    switch (block_side)
-    {
-    case Block::Side::Top:
-      return 0;
-    case Block::Side::Bottom:
-      return 2;
-    case Block::Side::Front:
-    case Block::Side::Back:
-    case Block::Side::Left:
-    case Block::Side::Right:
-      return 1;
-    }
-    assert(0);
-    return 0;
+    log_chunk_memory_usage();
   }
-  case Block::Type::Dirt:
+}
+
+void World::compress_cold_chunks(const glm::ivec3 &player_chunk_position)
+{
+  if (cold_chunk_radius_ == 0)
   {
-    return 2;
+    return;
   }
-  case Block::Type::Water:
+
+  if (!are_cold_chunks_scanned_ ||
+      player_chunk_position != cold_chunks_player_position_)
   {
-    return 3;
+    scan_cold_chunks(player_chunk_position);
   }
-  case Block::Type::Oak:
+
+  // The rest is compressed in the next frames. Chunks can be unloaded or
+  // decompressed by an edit in the meantime.
+  int         compressed_count = 0;
+  std::size_t bytes_before     = 0;
+  std::size_t bytes_after      = 0;
+  while (!cold_chunks_.empty() && compressed_count < max_compressions_per_frame)
   {
-    switch (block_side)
+    const auto position = cold_chunks_.back();
+    cold_chunks_.pop_back();
+
+    const auto iter = chunks_.find(position);
+    if (iter == chunks_.end())
+    {
+      continue;
+    }
+    auto &c = *iter->second.chunk;
+    if (c.is_compressed() || !c.is_generated())
     {
-    case Block::Side::Top:
-      return 5;
-    case Block::Side::Bottom:
-      return 5;
-    case Block::Side::Front:
-    case Block::Side::Back:
-    case Block::Side::Left:
-    case Block::Side::Right:
-      return 4;
+      continue;
     }
-    assert(0);
-    return 0;
+    bytes_before += c.memory_usage();
+    c.compress();
+    bytes_after += c.memory_usage();
+    ++compressed_count;
   }
-  case Block::Type::OakLeaves:
+
+  if (compressed_count > 0)
   {
-    return 6;
-  }
-  case Block::Type::Air:
-    assert(0);
-    return {};
+    LOG_DEBUG() << "Compressed " << compressed_count << " cold chunks from "
+                << bytes_before / 1024.0f << " KiB to "
+                << bytes_after / 1024.0f << " KiB, " << cold_chunks_.size()
+                << " left";
   }
-  assert(0);
-  return {};
 }
 
-void World::set_player_position(const glm::vec3 &position)
+void World::scan_cold_chunks(const glm::ivec3 &player_chunk_position)
 {
-  player_position_ = position;
-
-  // Generate chunks if needed
-  const auto current_chunk_position = position_to_chunk_position(position);
+  cold_chunks_player_position_ = player_chunk_position;
+  are_cold_chunks_scanned_     = true;
+  cold_chunks_.clear();
 
-  std::vector<glm::ivec3> need_mesh_generation;
+  // Decompressing is not limited, the streamer needs these chunks now
+  const auto warm_radius = chunk_streamer_->chunks_around_player() + 1;
 
-  for (int x = current_chunk_position.x - chunks_around_player_;
-       x <= current_chunk_position.x + chunks_around_player_;
-       ++x)
+  for (auto &[position, loaded_chunk] : chunks_)
   {
-    for (int z = current_chunk_position.z - chunks_around_player_;
-         z <= current_chunk_position.z + chunks_around_player_;
-         ++z)
+    auto      &c = *loaded_chunk.chunk;
+    const auto distance =
+        std::max(std::abs(position.x - player_chunk_position.x),
+                 std::abs(position.z - player_chunk_position.z));
+    if (c.is_compressed())
     {
-      // FIXME: This will fail for border chunks
-      if (!is_chunk(glm::vec3{x, current_chunk_position.y, z}))
+      if (distance <= warm_radius)
       {
-        continue;
-      }
-
-      auto &c = chunk(glm::ivec3{x, 0, z});
-      if (!c.is_generated())
-      {
-        const glm::ivec3 pos{x, 0, z};
-        c.generate(pos, *this);
-        need_mesh_generation.emplace_back(pos);
+        c.decompress();
       }
     }
+    else if (distance > cold_chunk_radius_ && c.is_generated())
+    {
+      cold_chunks_.push_back(position);
+    }
   }
+}
 
-  for (const auto &pos : need_mesh_generation)
+void World::log_chunk_memory_usage() const
+{
+  std::size_t chunk_count      = 0;
+  std::size_t bytes            = 0;
+  std::size_t compressed_count = 0;
+  std::size_t compressed_bytes = 0;
+  for (const auto &[position, loaded_chunk] : chunks_)
   {
-    auto &c = chunk(pos);
-    c.generate_mesh(*this);
-
-    // Regenarate neighbours if needed
+    if (loaded_chunk.chunk->is_generated())
     {
-      const glm::ivec3 neighbour_chunk_pos{pos.x - 1, pos.y, pos.z};
-      if (is_chunk(neighbour_chunk_pos))
-      {
-        auto &c = chunk(neighbour_chunk_pos);
-        if (c.is_generated() && c.is_mesh_generated())
-        {
-          c.regenerate_mesh(*this);
-        }
-      }
+      ++chunk_count;
+      bytes += loaded_chunk.chunk->memory_usage();
     }
+    if (loaded_chunk.chunk->is_compressed())
     {
-      const glm::ivec3 neighbour_chunk_pos{pos.x, pos.y, pos.z - 1};
-      if (is_chunk(neighbour_chunk_pos))
-      {
-        auto &c = chunk(neighbour_chunk_pos);
-        if (c.is_generated() && c.is_mesh_generated())
-        {
-          c.regenerate_mesh(*this);
-        }
-      }
+      ++compressed_count;
+      compressed_bytes += loaded_chunk.chunk->compressed_blocks().size;
     }
+  }
+
+  // What the same chunks would cost with one Block per voxel
+  const auto flat_bytes = chunk_count * Chunk::width() * Chunk::width() *
+                          Chunk::height() * sizeof(Block);
+
+  constexpr auto mib = 1024.0f * 1024.0f;
+  LOG_DEBUG() << "Chunk storage: " << chunk_count << " chunks use "
+              << bytes / mib << " MiB (one Block per voxel: "
+              << flat_bytes / mib << " MiB, "
+              << (bytes > 0 ? static_cast<float>(flat_bytes) / bytes : 0.0f)
+              << "x)";
+  LOG_DEBUG() << "Chunk cache: " << chunks_.size() << " chunks loaded, "
+              << free_chunks_.size() << " kept for reuse, "
+              << unloaded_chunk_count_ << " unloaded so far ("
+              << unloaded_bytes_ / mib << " MiB), " << compressed_count
+              << " compressed (" << compressed_bytes / mib << " MiB)";
+
+  const auto heightmap_statistics = heightmaps_->statistics();
+  LOG_DEBUG() << "Heightmaps: " << heightmap_statistics.cached_count
+              << " cached, " << heightmap_statistics.hit_count << " hits, "
+              << heightmap_statistics.miss_count << " misses";
+
+  const auto statistics = region_storage_->statistics();
+  if (statistics.saved_count > 0)
+  {
+    LOG_DEBUG() << "Chunk files: " << statistics.saved_count
+                << " chunks saved with "
+                << statistics.saved_bytes / statistics.saved_count
+                << " bytes/chunk, " << statistics.loaded_count
+                << " loaded and " << statistics.missing_count
+                << " not found, " << statistics.prefetch_count
+                << " regions prefetched";
+  }
+}
+
+void World::save_chunk(Chunk &c)
+{
+  if (!c.is_generated() || !c.is_modified())
+  {
+    return;
+  }
+  if (c.is_compressed())
+  {
+    // Already encoded the way the region files store it
+    const auto data = c.compressed_blocks();
+    region_storage_->save(c.position(),
+                          std::vector<std::uint8_t>(data.data,
+                                                    data.data + data.size));
+  }
+  else
+  {
+    region_storage_->save(c.position(), c.blocks(), c.is_decorated());
+  }
+  c.set_saved();
+}
+
+void World::unload_chunks(const glm::ivec3 &player_chunk_position)
+{
+  if (static_cast<int>(chunks_.size()) <= max_loaded_chunks_)
+  {
+    return;
+  }
+
+  std::size_t unloaded_count = 0;
+  std::size_t unloaded_bytes = 0;
+  std::vector<glm::ivec3> unloaded_positions;
+
+  // Walk from the least recently used chunk towards the most recently used
+  auto it = chunk_lru_.end();
+  while (it != chunk_lru_.begin() &&
+         static_cast<int>(chunks_.size()) > max_loaded_chunks_)
+  {
+    --it;
+    const auto position = *it;
+    const auto distance =
+        std::max(std::abs(position.x - player_chunk_position.x),
+                 std::abs(position.z - player_chunk_position.z));
+    auto loaded_chunk = chunks_.find(position);
+    assert(loaded_chunk != chunks_.end());
+    auto &c = loaded_chunk->second.chunk;
+
+    // A worker may still write into a generating chunk
+    if (distance <= chunk_keep_radius_ || c->is_generating())
     {
-      const glm::ivec3 neighbour_chunk_pos{pos.x + 1, pos.y, pos.z};
-      if (is_chunk(neighbour_chunk_pos))
-      {
-        auto &c = chunk(neighbour_chunk_pos);
-        if (c.is_generated() && c.is_mesh_generated())
-        {
-          c.regenerate_mesh(*this);
-        }
-      }
+      continue;
+    }
+
+    ++unloaded_count;
+    unloaded_bytes += c->memory_usage() + c->mesh_memory_usage();
+    unloaded_positions.push_back(position);
+    save_chunk(*c);
+
+    if (free_chunks_.size() < max_free_chunks)
+    {
+      free_chunks_.push_back(std::move(c));
     }
+    chunks_.erase(loaded_chunk);
+    it = chunk_lru_.erase(it);
+  }
+
+  // The neighbours of unloaded chunks show their border faces again
+  for (const auto &position : unloaded_positions)
+  {
+    for (const auto &offset : {glm::ivec3{-1, 0, 0},
+                               glm::ivec3{1, 0, 0},
+                               glm::ivec3{0, 0, -1},
+                               glm::ivec3{0, 0, 1}})
     {
-      const glm::ivec3 neighbour_chunk_pos{pos.x, pos.y, pos.z + 1};
-      if (is_chunk(neighbour_chunk_pos))
+      const auto neighbour_position = position + offset;
+      if (is_chunk(neighbour_position) &&
+          chunk(neighbour_position).is_mesh_requested())
       {
-        auto &c = chunk(neighbour_chunk_pos);
-        if (c.is_generated() && c.is_mesh_generated())
-        {
-          c.regenerate_mesh(*this);
-        }
+        chunk_streamer_->request_meshing(neighbour_position);
       }
     }
   }
-  need_mesh_generation.clear();
+
+  if (unloaded_count == 0)
+  {
+    return;
+  }
+
+  unloaded_chunk_count_ += unloaded_count;
+  unloaded_bytes_ += unloaded_bytes;
+  LOG_DEBUG() << "Unloaded " << unloaded_count << " chunks ("
+              << unloaded_bytes / 1024.0f << " KiB), " << chunks_.size()
+              << " chunks loaded";
 }
 
 Chunk &World::chunk_under_position(const glm::vec3 &position)
@@ -375,41 +463,72 @@ const Chunk &World::chunk_under_position(const glm::vec3 &position) const
   return chunk(chunk_position);
 }
 
-glm::ivec3
-World::chunk_position_to_storage_position(const glm::ivec3 &position) const
+const Chunk *World::generated_chunk(const glm::ivec3 &chunk_position) const
 {
-  const auto half_grid_size = grid_size_ / 2;
+  if (!is_chunk(chunk_position))
+  {
+    return nullptr;
+  }
+  const auto &c = chunk(chunk_position);
+  return c.is_generated() ? &c : nullptr;
+}
 
-  const auto real_x = position.x + half_grid_size;
-  const auto real_z = position.z + half_grid_size;
+const ChunkMesher &World::chunk_mesher() const { return chunk_mesher_; }
 
-  return {real_x, position.y, real_z};
+const ChunkDecorator &World::chunk_decorator() const
+{
+  return chunk_decorator_;
 }
 
+RegionStorage &World::region_storage() { return *region_storage_; }
+
 bool World::is_chunk(const glm::ivec3 &position) const
 {
-  const auto storage_position = chunk_position_to_storage_position(position);
+  return chunks_.find(position) != chunks_.end();
+}
+
+Chunk &World::load_chunk(const glm::ivec3 &position)
+{
+  assert(position.y == 0);
+
+  auto it = chunks_.find(position);
+  if (it != chunks_.end())
+  {
+    chunk_lru_.splice(chunk_lru_.begin(), chunk_lru_, it->second.lru_position);
+    return *it->second.chunk;
+  }
+
+  std::unique_ptr<Chunk> c;
+  if (free_chunks_.empty())
+  {
+    c = std::make_unique<Chunk>();
+  }
+  else
+  {
+    c = std::move(free_chunks_.back());
+    free_chunks_.pop_back();
+  }
+  c->reset(position);
 
-  return ((storage_position.y == 0) &&
-          (0 <= storage_position.x &&
-           storage_position.x < static_cast<int>(chunks_.size())) &&
-          (0 <= storage_position.z &&
-           storage_position.z <
-               static_cast<int>(chunks_[storage_position.x].size())));
+  chunk_lru_.push_front(position);
+  auto &loaded_chunk = chunks_[position];
+  loaded_chunk.chunk        = std::move(c);
+  loaded_chunk.lru_position = chunk_lru_.begin();
+  return *loaded_chunk.chunk;
 }
 
 Chunk &World::chunk(const glm::ivec3 &position)
 {
-  assert(is_chunk(position));
-  const auto storage_position = chunk_position_to_storage_position(position);
-  return chunks_[storage_position.x][storage_position.z];
+  const auto it = chunks_.find(position);
+  assert(it != chunks_.end());
+  return *it->second.chunk;
 }
 
 const Chunk &World::chunk(const glm::ivec3 &position) const
 {
-  assert(is_chunk(position));
-  const auto storage_position = chunk_position_to_storage_position(position);
-  return chunks_[storage_position.x][storage_position.z];
+  const auto it = chunks_.find(position);
+  assert(it != chunks_.end());
+  return *it->second.chunk;
 }
 
 void World::draw_blocks(const glm::mat4 &view_matrix,
@@ -442,27 +561,23 @@ void World::draw_blocks(const glm::mat4 &view_matrix,
   glBindTexture(GL_TEXTURE_2D_ARRAY, block_textures_->id());
 
   // First draw solid blocks
-  for (std::size_t x = 0; x < chunks_.size(); ++x)
+  for (auto &[position, loaded_chunk] : chunks_)
   {
-    for (std::size_t z = 0; z < chunks_[x].size(); ++z)
+    auto &c = *loaded_chunk.chunk;
+    if (!c.is_mesh_generated())
     {
-      // FIXME: This will fail for border chunks
-      auto &c = chunks_[x][z];
-      if (!c.is_mesh_generated())
-      {
-        continue;
-      }
-      const auto chunk_position = c.position();
-      // Set model matrix
-      const auto chunk_model_matrix =
-          glm::translate(glm::mat4(1.0f),
-                         glm::vec3(chunk_position.x * Chunk::width(),
-                                   0,
-                                   chunk_position.z * Chunk::width()));
-      world_shader_->set_uniform("model_matrix", chunk_model_matrix);
-
-      c.draw(*world_shader_);
+      continue;
     }
+    const auto chunk_position = c.position();
+    // Set model matrix
+    const auto chunk_model_matrix =
+        glm::translate(glm::mat4(1.0f),
+                       glm::vec3(chunk_position.x * Chunk::width(),
+                                 0,
+                                 chunk_position.z * Chunk::width()));
+    world_shader_->set_uniform("model_matrix", chunk_model_matrix);
+
+    c.draw(*world_shader_);
   }
 
   world_shader_->unbind();
@@ -516,27 +631,23 @@ void World::draw_water(const glm::mat4 &view_matrix,
   water_shader_->set_uniform("dudv_tex", 2);
 
   // Then draw transparent water
-  for (std::size_t x = 0; x < chunks_.size(); ++x)
+  for (auto &[position, loaded_chunk] : chunks_)
   {
-    for (std::size_t z = 0; z < chunks_[x].size(); ++z)
+    auto &c = *loaded_chunk.chunk;
+    if (!c.is_mesh_generated())
     {
-      // FIXME: This will fail for border chunks
-      auto &c = chunks_[x][z];
-      if (!c.is_mesh_generated())
-      {
-        continue;
-      }
-      const auto chunk_position = c.position();
-      // Set model matrix
-      const auto chunk_model_matrix =
-          glm::translate(glm::mat4(1.0f),
-                         glm::vec3(chunk_position.x * Chunk::width(),
-                                   0,
-                                   chunk_position.z * Chunk::width()));
-      water_shader_->set_uniform("model_matrix", chunk_model_matrix);
-
-      c.draw_water(*water_shader_);
+      continue;
     }
+    const auto chunk_position = c.position();
+    // Set model matrix
+    const auto chunk_model_matrix =
+        glm::translate(glm::mat4(1.0f),
+                       glm::vec3(chunk_position.x * Chunk::width(),
+                                 0,
+                                 chunk_position.z * Chunk::width()));
+    water_shader_->set_uniform("model_matrix", chunk_model_matrix);
+
+    c.draw_water(*water_shader_);
   }
 }
 
@@ -602,24 +713,29 @@ bool World::is_chunk_under_position(const glm::ivec3 &world_position) const
   return is_chunk(chunk_position);
 }
 
-bool World::is_block(const glm::ivec3 &world_position) const
+bool World::is_block_loaded(const glm::ivec3 &world_position) const
 {
-  const auto [chunk_position, block_position] =
+  const auto [chunk_position, _] =
       world_position_to_chunk_position(world_position);
 
-  if (!is_chunk(chunk_position))
-  {
-    return false;
-  }
+  const auto c = generated_chunk(chunk_position);
+  return c != nullptr && !c->is_compressed();
+}
 
-  auto      &c          = chunk(chunk_position);
-  const auto block_type = c.block_type(block_position);
+int World::surface_height(int x, int z) const
+{
+  return heightmaps_->surface_height(x, z);
+}
 
-  return block_type != Block::Type::Air;
+float World::water_level() const { return water_level_; }
+
+std::shared_ptr<const ChunkHeightmap>
+World::heightmap(const glm::ivec2 &chunk_position) const
+{
+  return heightmaps_->heightmap(chunk_position);
 }
 
-[[nodiscard]] bool World::is_block(const glm::ivec3 &world_position,
-                                   Block::Type       type) const
+bool World::is_block(const glm::ivec3 &world_position) const
 {
   const auto [chunk_position, block_position] =
       world_position_to_chunk_position(world_position);
@@ -629,15 +745,14 @@ bool World::is_block(const glm::ivec3 &world_position) const
     return false;
   }
 
-  auto      &c          = chunk(chunk_position);
-  const auto block_type = c.block_type(block_position);
-
-  if (type == Block::Type::Water)
+  auto &c = chunk(chunk_position);
+  if (!c.is_generated() || c.is_compressed())
   {
-    return block_type != Block::Type::Air;
+    return false;
   }
+  const auto block_type = c.block_type(block_position);
 
-  return block_type != Block::Type::Air && block_type != Block::Type::Water;
+  return block_type != Block::Type::Air;
 }
 
 bool World::remove_block(const glm::vec3 &position)
@@ -653,6 +768,10 @@ bool World::remove_block(const glm::vec3 &position)
       world_position_to_chunk_position(block_position);
 
   auto &c = chunk(chunk_position);
+  if (!c.is_mesh_generated())
+  {
+    return false;
+  }
 
   return c.remove_block(*this, block_in_chunk_position);
 }
@@ -671,7 +790,8 @@ bool World::place_block(const Ray &ray)
       world_position_to_chunk_position(block_position);
 
   auto &c = chunk(chunk_position);
-  if (c.block_type(block_in_chunk_position) == Block::Type::Air)
+  if (!c.is_mesh_generated() ||
+      c.block_type(block_in_chunk_position) == Block::Type::Air)
   {
     return false;
   }
@@ -697,14 +817,49 @@ bool World::place_block(const Ray &ray)
   return false;
 }
 
-void World::regenerate_chunk(const glm::ivec3 &chunk_position)
+void World::mark_chunk_dirty(const glm::ivec3 &chunk_position)
 {
   if (!is_chunk(chunk_position))
   {
     return;
   }
-  auto &c = chunk(chunk_position);
-  c.regenerate_mesh(*this);
+  chunk_streamer_->mark_dirty(chunk_position);
+}
+
+std::vector<glm::ivec3>
+World::place_decoration(const std::vector<DecorationBlock> &blocks)
+{
+  std::vector<glm::ivec3> changed_chunks;
+  for (const auto &block : blocks)
+  {
+    const auto [chunk_position, block_position] =
+        world_position_to_chunk_position(block.position);
+    if (!is_chunk(chunk_position))
+    {
+      continue;
+    }
+
+    auto &c = chunk(chunk_position);
+    if (!c.is_generated())
+    {
+      continue;
+    }
+    if (c.is_compressed())
+    {
+      c.decompress();
+    }
+
+    if (c.place_decoration_block(block_position,
+                                 block.type,
+                                 block.is_replacing) &&
+        std::find(changed_chunks.begin(),
+                  changed_chunks.end(),
+                  chunk_position) == changed_chunks.end())
+    {
+      changed_chunks.push_back(chunk_position);
+    }
+  }
+  return changed_chunks;
 }
 
 void World::on_window_resize_event(std::shared_ptr<Event> /*event*/)
@@ -712,6 +867,26 @@ void World::on_window_resize_event(std::shared_ptr<Event> /*event*/)
   recreate_framebuffer();
 }
 
+void World::on_settings_changed_event(std::shared_ptr<Event> event)
+{
+  apply_settings(
+      std::static_pointer_cast<SettingsChangedEvent>(event)->settings());
+}
+
+void World::apply_settings(const Settings &settings)
+{
+  debug_sun_   = settings.world.debug_sun;
+  fog_start_   = settings.world.fog_start;
+  fog_end_     = settings.world.fog_end;
+  fog_color_   = settings.world.sky_color;
+  water_speed_ = settings.chunk.water_speed;
+
+  if (chunk_streamer_)
+  {
+    chunk_streamer_->apply_settings(settings.world);
+  }
+}
+
 void World::recreate_framebuffer()
 {
   // Create the reflection framebuffer
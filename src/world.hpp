@@ -3,6 +3,9 @@
 #include "block.hpp"
 #include "camera.hpp"
 #include "chunk.hpp"
+#include "chunk_decorator.hpp"
+#include "chunk_mesher.hpp"
+#include "chunk_streamer.hpp"
 #include "debug_draw.hpp"
 #include "event.hpp"
 #include "gl/gl_framebuffer.hpp"
@@ -11,11 +14,18 @@
 #include "gl/gl_texture.hpp"
 #include "gl/gl_texture_array.hpp"
 #include "gui_texture.hpp"
+#include "heightmap.hpp"
 #include "math.hpp"
 #include "ray.hpp"
+#include "region_storage.hpp"
+#include "settings.hpp"
 
 #include <array>
+#include <cstddef>
+#include <list>
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 class World
 {
@@ -25,32 +35,99 @@ public:
 
   void init();
 
-  void set_player_position(const glm::vec3 &position);
+  // Streams in chunks around the position, prioritizing the view direction
+  void set_player_position(const glm::vec3 &position,
+                           const glm::vec3 &view_direction);
 
   void draw(const Camera    &camera,
             const glm::mat4 &projection_matrix,
             DebugDraw       &debug_draw);
 
   [[nodiscard]] bool is_block(const glm::ivec3 &world_position) const;
-  [[nodiscard]] bool is_block(const glm::ivec3 &world_position,
-                              Block::Type       type) const;
+
+  // Whether the blocks at the position are generated and can be read
+  [[nodiscard]] bool is_block_loaded(const glm::ivec3 &world_position) const;
+
+  // Height of the terrain at a block column, without trees and water. Does
+  // not need the chunk to be loaded and ignores edits.
+  [[nodiscard]] int surface_height(int x, int z) const;
+
+  // The water level the terrain was generated with
+  [[nodiscard]] float water_level() const;
+
+  // Terrain heights of the columns of a chunk. Can be called from any
+  // thread.
+  std::shared_ptr<const ChunkHeightmap>
+  heightmap(const glm::ivec2 &chunk_position) const;
 
   bool remove_block(const glm::vec3 &position);
   bool place_block(const Ray &ray);
 
-  void regenerate_chunk(const glm::ivec3 &chunk_position);
+  // Re-meshes the chunk at the end of the frame
+  void mark_chunk_dirty(const glm::ivec3 &chunk_position);
+
+  // Places the blocks of a decoration in the loaded chunks and returns the
+  // positions of the chunks that changed
+  std::vector<glm::ivec3>
+  place_decoration(const std::vector<DecorationBlock> &blocks);
+
+  // Returns the chunk if it exists and is generated, nullptr otherwise
+  const Chunk *generated_chunk(const glm::ivec3 &chunk_position) const;
 
-  int block_texture_index(Block::Type block_type, Block::Side block_side) const;
+  const ChunkMesher    &chunk_mesher() const;
+  const ChunkDecorator &chunk_decorator() const;
+
+  RegionStorage &region_storage();
+
+  // Whether the chunk at the position is loaded
+  bool is_chunk(const glm::ivec3 &position) const;
+
+  // Returns the chunk at the position, loading an empty one if needed. Marks
+  // the chunk as most recently used.
+  Chunk &load_chunk(const glm::ivec3 &position);
+
+  Chunk       &chunk(const glm::ivec3 &position);
+  const Chunk &chunk(const glm::ivec3 &position) const;
 
 private:
-  int grid_size_            = 64;
-  int chunks_around_player_ = 16;
+  struct LoadedChunk
+  {
+    std::unique_ptr<Chunk>          chunk;
+    std::list<glm::ivec3>::iterator lru_position;
+  };
+
+  // Unloaded chunks kept for reuse, so their memory and GPU buffers do not
+  // need to be allocated again
+  static constexpr std::size_t max_free_chunks = 64;
+
+  // Chunks within this many chunks around the player are never unloaded
+  int chunk_keep_radius_ = 0;
+  // Chunks outside of the keep radius are unloaded, least recently used
+  // first, as long as more than this many chunks are loaded
+  int max_loaded_chunks_ = 1600;
+
+  // Chunks further away than this are compressed, 0 keeps all chunks
+  // uncompressed
+  int cold_chunk_radius_ = 0;
+  // Limits the time compression takes per frame
+  static constexpr int max_compressions_per_frame = 8;
+  // Chunks outside of the cold radius that are still uncompressed. Only
+  // rescanned when the player moves to another chunk.
+  std::vector<glm::ivec3> cold_chunks_;
+  glm::ivec3              cold_chunks_player_position_{};
+  bool                    are_cold_chunks_scanned_ = false;
 
   bool debug_sun_ = false;
 
   float water_level_ = 5.0f;
 
-  std::vector<std::vector<Chunk>> chunks_;
+  std::unordered_map<glm::ivec3, LoadedChunk, ChunkPositionHash> chunks_;
+  // Positions of the loaded chunks, most recently used first
+  std::list<glm::ivec3>               chunk_lru_;
+  std::vector<std::unique_ptr<Chunk>> free_chunks_;
+
+  std::size_t unloaded_chunk_count_ = 0;
+  std::size_t unloaded_bytes_       = 0;
 
   glm::vec3 player_position_{glm::vec3(0.0f)};
 
@@ -75,19 +152,29 @@ private:
   float water_move_factor_{0.0f};
   float water_speed_{0.03f};
 
-  bool is_chunk(const glm::ivec3 &position) const;
+  ChunkMesher    chunk_mesher_;
+  ChunkDecorator chunk_decorator_;
+
+  std::unique_ptr<HeightmapCache> heightmaps_{};
+  std::unique_ptr<RegionStorage>  region_storage_{};
+  std::unique_ptr<ChunkStreamer>  chunk_streamer_{};
+
+  // Unloads chunks outside of the keep radius while too many are loaded
+  void unload_chunks(const glm::ivec3 &player_chunk_position);
+
+  // Compresses chunks outside of the cold radius and decompresses the ones
+  // the player came close to again
+  void compress_cold_chunks(const glm::ivec3 &player_chunk_position);
+  void scan_cold_chunks(const glm::ivec3 &player_chunk_position);
 
-  glm::ivec3
-  chunk_position_to_storage_position(const glm::ivec3 &position) const;
+  // Queues the chunk for saving if it changed since it was loaded
+  void save_chunk(Chunk &c);
 
   bool is_chunk_under_position(const glm::ivec3 &world_positon) const;
 
   Chunk       &chunk_under_position(const glm::vec3 &position);
   const Chunk &chunk_under_position(const glm::vec3 &position) const;
 
-  Chunk       &chunk(const glm::ivec3 &position);
-  const Chunk &chunk(const glm::ivec3 &position) const;
-
   void draw_blocks(const glm::mat4 &view_matrix,
                    const glm::mat4 &projection_matrix,
                    const glm::vec4 &clip_plane = glm::vec4{0.0f});
@@ -95,6 +182,13 @@ private:
                   const glm::mat4 &projection_matrix);
 
   void on_window_resize_event(std::shared_ptr<Event> event);
+  void on_settings_changed_event(std::shared_ptr<Event> event);
+
+  // Takes over the settings that can change while the world exists. The
+  // terrain, the chunk size and the streaming radius need a restart.
+  void apply_settings(const Settings &settings);
+
+  void log_chunk_memory_usage() const;
 
   void recreate_framebuffer();
 };
@@ -0,0 +1,315 @@
+#include "block.hpp"
+#include "chunk.hpp"
+#include "chunk_codec.hpp"
+#include "chunk_mesher.hpp"
+#include "heightmap.hpp"
+#include "log/log.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Meshes chunks with every mesher and checks that the quads cover the same
+// block faces. The naive mesher emits one quad per visible face, the others
+// must merge exactly these.
+
+namespace
+{
+using Face = std::array<int, 6>;
+
+// How the blocks of a section are filled. Empty and buried sections are
+// skipped while meshing.
+enum class Fill
+{
+  Empty,
+  Full,
+  Water,
+  Random,
+};
+
+// The unit faces the quads cover, sorted
+std::vector<Face> faces(const std::vector<MeshQuad> &quads)
+{
+  std::vector<Face> covered;
+  for (const auto &quad : quads)
+  {
+    for (int x = 0; x < quad.size.x; ++x)
+    {
+      for (int y = 0; y < quad.size.y; ++y)
+      {
+        for (int z = 0; z < quad.size.z; ++z)
+        {
+          covered.push_back({quad.face,
+                             quad.position.x + x,
+                             quad.position.y + y,
+                             quad.position.z + z,
+                             quad.tex_index,
+                             quad.is_water});
+        }
+      }
+    }
+  }
+  std::sort(covered.begin(), covered.end());
+  return covered;
+}
+
+// A generated chunk of air
+std::unique_ptr<Chunk> air_chunk(const glm::ivec3 &position)
+{
+  static const auto air = encode_chunk_blocks(
+      ChunkBlockStorage{Chunk::width(), Chunk::height()}, true);
+
+  auto c = std::make_unique<Chunk>();
+  c->reset(position);
+  c->load(air);
+  return c;
+}
+
+// Fills every section of the chunk the way the fills say, the last fill
+// repeats for the sections above
+std::unique_ptr<Chunk> filled_chunk(const glm::ivec3       &position,
+                                    const std::vector<Fill> &fills,
+                                    std::mt19937            &rng)
+{
+  constexpr std::array<Block::Type, 6> random_types{Block::Type::Grass,
+                                                    Block::Type::Dirt,
+                                                    Block::Type::Water,
+                                                    Block::Type::Oak,
+                                                    Block::Type::OakLeaves,
+                                                    Block::Type::Air};
+  std::uniform_int_distribution<std::size_t> random_type(
+      0, random_types.size() - 1);
+
+  auto c = air_chunk(position);
+  for (int y = 0; y < Chunk::height(); ++y)
+  {
+    const auto section = y / Chunk::section_height;
+    const auto fill = fills[std::min<std::size_t>(section, fills.size() - 1)];
+    for (int x = 0; x < Chunk::width(); ++x)
+    {
+      for (int z = 0; z < Chunk::width(); ++z)
+      {
+        auto type = Block::Type::Air;
+        switch (fill)
+        {
+        case Fill::Empty:
+          break;
+        case Fill::Full:
+          type = Block::Type::Dirt;
+          break;
+        case Fill::Water:
+          type = Block::Type::Water;
+          break;
+        case Fill::Random:
+          type = random_types[random_type(rng)];
+          break;
+        }
+        c->place_decoration_block(glm::ivec3{x, y, z}, type, true);
+      }
+    }
+  }
+  return c;
+}
+
+// Water with opaque blocks and leaves in and around it
+std::unique_ptr<Chunk> pond_chunk(const glm::ivec3 &position)
+{
+  auto c = air_chunk(position);
+  for (int x = 0; x < Chunk::width(); ++x)
+  {
+    for (int z = 0; z < Chunk::width(); ++z)
+    {
+      for (int y = 0; y < 8; ++y)
+      {
+        c->place_decoration_block(glm::ivec3{x, y, z}, Block::Type::Dirt, true);
+      }
+      for (int y = 8; y < 12; ++y)
+      {
+        c->place_decoration_block(
+            glm::ivec3{x, y, z}, Block::Type::Water, true);
+      }
+      if ((x + z) % 3 == 0)
+      {
+        c->place_decoration_block(
+            glm::ivec3{x, 8 + (x + z) % 5, z}, Block::Type::Grass, true);
+      }
+      if ((x * z) % 5 == 1)
+      {
+        c->place_decoration_block(
+            glm::ivec3{x, 12, z}, Block::Type::OakLeaves, true);
+      }
+    }
+  }
+  return c;
+}
+
+// Terrain the way the world generates it, without the trees
+std::unique_ptr<Chunk> terrain_chunk(const glm::ivec3 &position,
+                                     HeightmapCache   &heightmaps)
+{
+  auto c = std::make_unique<Chunk>();
+  c->reset(position);
+  c->generate(*heightmaps.heightmap(glm::ivec2{position.x, position.z}));
+  return c;
+}
+
+// Returns the number of meshers that did not cover the faces of the naive
+// mesher
+int check(const std::string                  &name,
+          const Chunk                        &c,
+          const std::array<const Chunk *, 4> &neighbours)
+{
+  const ChunkSnapshot snapshot{c, neighbours};
+
+  std::vector<MeshQuad> quads;
+  ChunkMesher::generate_naive_quads(snapshot, quads);
+  const auto expected = faces(quads);
+  if (std::adjacent_find(expected.begin(), expected.end()) != expected.end())
+  {
+    LOG_ERROR() << name << ": the naive mesher emits a face twice";
+    return 1;
+  }
+
+  using GenerateQuads =
+      void (*)(const ChunkSnapshot &, std::vector<MeshQuad> &);
+  std::vector<std::pair<const char *, GenerateQuads>> meshers{
+      {"greedy", ChunkMesher::generate_greedy_quads}};
+  if (Chunk::width() <= 62)
+  {
+    meshers.push_back({"binary", ChunkMesher::generate_binary_quads});
+  }
+
+  int failure_count = 0;
+  for (const auto &[mesher, generate_quads] : meshers)
+  {
+    quads.clear();
+    generate_quads(snapshot, quads);
+    const auto covered = faces(quads);
+    if (covered != expected)
+    {
+      LOG_ERROR() << name << ": the " << mesher << " mesher covers "
+                  << covered.size() << " faces, the naive one "
+                  << expected.size();
+      ++failure_count;
+    }
+  }
+  return failure_count;
+}
+} // namespace
+
+int main()
+{
+  std::mt19937 rng(1);
+  int          failure_count = 0;
+  int          check_count   = 0;
+
+  const auto run = [&](const std::string                  &name,
+                       const Chunk                        &c,
+                       const std::array<const Chunk *, 4> &neighbours)
+  {
+    failure_count += check(name, c, neighbours);
+    ++check_count;
+  };
+  const std::array<const Chunk *, 4> no_neighbours{};
+
+  const auto empty = air_chunk(glm::ivec3{0});
+  run("empty chunk", *empty, no_neighbours);
+
+  const auto full = filled_chunk(glm::ivec3{0}, {Fill::Full}, rng);
+  run("full chunk", *full, no_neighbours);
+  run("full chunk between full chunks",
+      *full,
+      {full.get(), full.get(), full.get(), full.get()});
+  run("full chunk between empty chunks",
+      *full,
+      {empty.get(), empty.get(), empty.get(), empty.get()});
+
+  // Empty, buried and water sections, with faces between them
+  const auto layered =
+      filled_chunk(glm::ivec3{0},
+                   {Fill::Full, Fill::Full, Fill::Empty, Fill::Water,
+                    Fill::Random, Fill::Full, Fill::Empty},
+                   rng);
+  run("layered chunk", *layered, no_neighbours);
+  run("layered chunk between full chunks",
+      *layered,
+      {full.get(), full.get(), full.get(), full.get()});
+  run("layered chunk between layered chunks",
+      *layered,
+      {layered.get(), layered.get(), layered.get(), layered.get()});
+
+  const auto pond = pond_chunk(glm::ivec3{0});
+  run("water next to opaque blocks", *pond, no_neighbours);
+  run("water next to opaque blocks between full chunks",
+      *pond,
+      {full.get(), full.get(), full.get(), full.get()});
+  run("water next to opaque blocks between water",
+      *pond,
+      {pond.get(), layered.get(), pond.get(), layered.get()});
+
+  // Every border sees another chunk
+  for (int i = 0; i < 8; ++i)
+  {
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    for (int j = 0; j < 5; ++j)
+    {
+      std::vector<Fill> fills;
+      for (int section = 0; section < Chunk::section_count(); ++section)
+      {
+        fills.push_back(static_cast<Fill>(rng() % 4));
+      }
+      chunks.push_back(filled_chunk(glm::ivec3{0}, fills, rng));
+    }
+    run("random chunk " + std::to_string(i),
+        *chunks[0],
+        {chunks[1].get(), chunks[2].get(), chunks[3].get(), chunks[4].get()});
+    run("random chunk " + std::to_string(i) + " with missing neighbours",
+        *chunks[0],
+        {nullptr, chunks[2].get(), nullptr, chunks[4].get()});
+  }
+
+  // A square of terrain, the inner chunks have all their neighbours
+  HeightmapCache                      heightmaps;
+  std::vector<std::unique_ptr<Chunk>> terrain;
+  for (int x = -2; x <= 2; ++x)
+  {
+    for (int z = -2; z <= 2; ++z)
+    {
+      terrain.push_back(terrain_chunk(glm::ivec3{x, 0, z}, heightmaps));
+    }
+  }
+  const auto terrain_chunk_at = [&terrain](int x, int z) -> const Chunk *
+  {
+    if (std::abs(x) > 2 || std::abs(z) > 2)
+    {
+      return nullptr;
+    }
+    return terrain[(x + 2) * 5 + z + 2].get();
+  };
+  for (const auto &c : terrain)
+  {
+    const auto position = c->position();
+    run("terrain chunk " + std::to_string(position.x) + ", " +
+            std::to_string(position.z),
+        *c,
+        {terrain_chunk_at(position.x - 1, position.z),
+         terrain_chunk_at(position.x + 1, position.z),
+         terrain_chunk_at(position.x, position.z - 1),
+         terrain_chunk_at(position.x, position.z + 1)});
+  }
+
+  if (failure_count > 0)
+  {
+    LOG_ERROR() << failure_count << " meshers failed in " << check_count
+                << " chunks";
+    return EXIT_FAILURE;
+  }
+  LOG_INFO() << "All meshers cover the same faces in " << check_count
+             << " chunks";
+  return EXIT_SUCCESS;
+}